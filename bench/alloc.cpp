@@ -0,0 +1,107 @@
+#include <emlite/emlite.hpp>
+#include <emlite/slab.hpp>
+
+using namespace emlite;
+
+// Allocator benchmark, driven by bench/node_bench_alloc.js.
+// A window of live blocks is churned: every step frees a random slot and
+// allocates a block of a size drawn from one of emlite's allocation profiles
+// into it, through either the emcore backend or the slab allocator. The
+// runner times each run and measures memory growth on a fresh instance.
+
+namespace {
+constexpr size_t max_window = 4096;
+void *slots[max_window];
+uint32_t sizes[max_window];
+uint32_t rng_state = 0x9e3779b9u;
+
+uint32_t rng() {
+    // xorshift32, deterministic so that every allocator sees the same sequence
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+enum Pattern {
+    Closures, // Closure blocks of callbacks
+    Handles,  // Handle arrays of argument lists
+    Strings,  // Short strings copied from javascript
+    Mixed,    // All of the above with typed array copies
+    PatternCount,
+};
+
+constexpr size_t windows[PatternCount] = {256, 1024, 4096, 4096};
+
+uint32_t draw_size(int pattern) {
+    uint32_t r = rng();
+    switch (pattern) {
+    case Closures: {
+        constexpr uint32_t closure_sizes[] = {16, 24, 32, 48};
+        return closure_sizes[r & 3];
+    }
+    case Handles:
+        return 4 * (1 + (r >> 8) % 16);
+    case Strings:
+        return 1 + (r >> 8) % 256;
+    default: {
+        uint32_t pick = r % 100;
+        if (pick < 90)
+            return 8 + (r >> 8) % 249;
+        if (pick < 99)
+            return 256 + (r >> 8) % 3841;
+        return 4096 + (r >> 8) % 61441;
+    }
+    }
+}
+
+void *do_malloc(int allocator, size_t size) {
+    return allocator ? slab_malloc(size) : emlite_malloc(size);
+}
+
+void do_free(int allocator, void *p) {
+    if (allocator)
+        slab_free(p);
+    else
+        emlite_free(p);
+}
+} // namespace
+
+/// Runs `ops` steps of a pattern (0 closures, 1 handles, 2 strings, 3 mixed)
+/// with the backend (allocator 0) or the slab allocator (allocator 1), then
+/// frees the whole window
+/// @returns the peak of requested bytes live at once
+EMLITE_USED extern "C" size_t bench_alloc_run(int allocator, int pattern, int ops) {
+    size_t window = windows[pattern];
+    size_t live   = 0;
+    size_t peak   = 0;
+    for (int i = 0; i < ops; ++i) {
+        size_t slot = rng() % window;
+        if (slots[slot]) {
+            do_free(allocator, slots[slot]);
+            live -= sizes[slot];
+        }
+        uint32_t size = draw_size(pattern);
+        auto p        = static_cast<char *>(do_malloc(allocator, size));
+        if (!p)
+            return 0;
+        // Touch the block as its user would
+        p[0]        = 1;
+        p[size - 1] = 1;
+        slots[slot] = p;
+        sizes[slot] = size;
+        live += size;
+        if (live > peak)
+            peak = live;
+    }
+    for (size_t slot = 0; slot < window; ++slot) {
+        do_free(allocator, slots[slot]);
+        slots[slot] = nullptr;
+    }
+    return peak;
+}
+
+/// @returns the bytes the slab allocator took from the backend
+EMLITE_USED extern "C" size_t bench_alloc_slab_footprint() { return slab_stats().footprint; }
+
+int main() { emlite::init(); }
@@ -0,0 +1,218 @@
+#include <emlite/emlite.hpp>
+
+using namespace emlite;
+
+// Boundary crossing microbenchmarks, driven by bench/node_bench.js.
+// Each benchmark runs in batches of doubling size until a batch takes long
+// enough to time, then the results are reported as a JSON string: through
+// `globalThis.emliteBenchReport` when the runner defines it, or on the console.
+
+namespace {
+// Minimum duration of a timed batch in milliseconds
+constexpr double min_batch_ms = 200;
+
+// Keeps the compiler from discarding the measured work
+volatile uint32_t sink;
+
+double now() {
+    static const Val performance = Val::global("performance");
+    return performance.call(EMLITE_ATOM("now")).as<double>();
+}
+
+template <typename F>
+void bench(const Val &results, const char *name, F &&f) {
+    // Warm up, letting the JIT tier up the imports
+    for (int i = 0; i < 1000; ++i)
+        f();
+    size_t iters = 1000;
+    double ms    = 0;
+    for (;;) {
+        double start = now();
+        for (size_t i = 0; i < iters; ++i)
+            f();
+        ms = now() - start;
+        if (ms >= min_batch_ms || iters >= (size_t(1) << 30))
+            break;
+        iters *= 2;
+    }
+    auto row = Val::object();
+    row.set("name", name);
+    row.set("iters", static_cast<double>(iters));
+    row.set("ns_per_op", ms * 1e6 / static_cast<double>(iters));
+    row.set("ops_per_sec", static_cast<double>(iters) * 1e3 / ms);
+    results.call("push", row);
+}
+
+// Strings of each size are filled with ASCII, then with 2-byte UTF-8 sequences
+constexpr size_t str_sizes[] = {8, 64, 1024, 16384};
+char str_ascii[16384];
+char str_utf8[16384];
+
+// Arrays for from_span and vec_from_js_array
+constexpr size_t array_sizes[] = {16, 1024, 65536};
+int32_t ints[65536];
+
+Handle callback(Handle args, Handle) {
+    // Returns its first argument, so a call does one crossing each way
+    return Val::take_ownership(args)[0].release_handle();
+}
+
+// Calls a method the way Val::call did before the argv imports, through a
+// temporary array filled by one push per argument, as the baseline of the
+// call_* benchmarks
+template <typename... Args>
+Handle call_through_array(const Val &obj, const char *name, const Args &...args) {
+    auto arr = Val::array();
+    (emlite_val_push(arr.as_handle(), args.as_handle()), ...);
+    return emlite_val_obj_call(obj.as_handle(), name, strlen(name), arr.as_handle());
+}
+
+void run_property_benches(const Val &results) {
+    auto obj = Val::object();
+    obj.set("x", 1);
+    const auto &key = EMLITE_ATOM("x");
+    bench(results, "get", [&] { sink = obj.get(key).as<int>(); });
+    bench(results, "get_str_key", [&] { sink = obj.get("x").as<int>(); });
+    bench(results, "set", [&] { obj.set(key, 2); });
+    bench(results, "set_str_key", [&] { obj.set("x", 2); });
+}
+
+void run_call_benches(const Val &results) {
+    auto math       = Val::global("Math");
+    const auto &max = EMLITE_ATOM("max");
+    Val a(1), b(2), c(3), d(4);
+    bench(results, "call_0_args", [&] { sink = math.call(max).as_handle(); });
+    bench(results, "call_1_arg", [&] { sink = math.call(max, a).as_handle(); });
+    bench(results, "call_2_args", [&] { sink = math.call(max, a, b).as_handle(); });
+    bench(results, "call_3_args", [&] { sink = math.call(max, a, b, c).as_handle(); });
+    bench(results, "call_4_args", [&] { sink = math.call(max, a, b, c, d).as_handle(); });
+    bench(results, "call_8_args", [&] {
+        sink = math.call(max, a, b, c, d, a, b, c, d).as_handle();
+    });
+    bench(results, "call_array_0_args", [&] {
+        sink = Val::take_ownership(call_through_array(math, "max")).as_handle();
+    });
+    bench(results, "call_array_1_arg", [&] {
+        sink = Val::take_ownership(call_through_array(math, "max", a)).as_handle();
+    });
+    bench(results, "call_array_3_args", [&] {
+        sink = Val::take_ownership(call_through_array(math, "max", a, b, c)).as_handle();
+    });
+    bench(results, "call_array_8_args", [&] {
+        auto h = call_through_array(math, "max", a, b, c, d, a, b, c, d);
+        sink   = Val::take_ownership(h).as_handle();
+    });
+
+    auto object = Val::intrinsic(Intrinsic::Object);
+    auto array  = Val::intrinsic(Intrinsic::Array);
+    Val len(8);
+    bench(results, "new_0_args", [&] { sink = object.new_().as_handle(); });
+    bench(results, "new_1_arg", [&] { sink = array.new_(len).as_handle(); });
+}
+
+void run_function_benches(const Val &results) {
+    auto fn = Val::make_fn(&callback);
+    Val arg(1);
+    bench(results, "make_fn_invoke", [&] { sink = fn(arg).as_handle(); });
+    bench(results, "make_fn_create", [&] { sink = Val::make_fn(&callback).as_handle(); });
+    bench(results, "make_fn_closure_create", [&] {
+        int captured = 1;
+        auto f       = Val::make_fn([captured](Params) -> Val { return Val(captured); });
+        sink         = f.as_handle();
+        Val::dispose_fn(f);
+    });
+}
+
+void run_string_benches(const Val &results) {
+    for (size_t i = 0; i < sizeof(str_ascii); ++i)
+        str_ascii[i] = static_cast<char>('a' + i % 26);
+    for (size_t i = 0; i + 1 < sizeof(str_utf8); i += 2) {
+        // U+00E9
+        str_utf8[i]     = '\xC3';
+        str_utf8[i + 1] = '\xA9';
+    }
+    static const char *const names[][2] = {
+        {"str_to_js_ascii_8", "str_roundtrip_ascii_8"},
+        {"str_to_js_ascii_64", "str_roundtrip_ascii_64"},
+        {"str_to_js_ascii_1024", "str_roundtrip_ascii_1024"},
+        {"str_to_js_ascii_16384", "str_roundtrip_ascii_16384"},
+    };
+    static const char *const utf8_names[][2] = {
+        {"str_to_js_utf8_8", "str_roundtrip_utf8_8"},
+        {"str_to_js_utf8_64", "str_roundtrip_utf8_64"},
+        {"str_to_js_utf8_1024", "str_roundtrip_utf8_1024"},
+        {"str_to_js_utf8_16384", "str_roundtrip_utf8_16384"},
+    };
+    for (size_t s = 0; s < sizeof(str_sizes) / sizeof(str_sizes[0]); ++s) {
+        size_t n = str_sizes[s];
+        bench(results, names[s][0], [&] { sink = Val(StrView(str_ascii, n)).as_handle(); });
+        bench(results, names[s][1], [&] {
+            String str(Val(StrView(str_ascii, n)));
+            sink = static_cast<uint32_t>(str.c_str()[0]);
+        });
+        bench(results, utf8_names[s][0], [&] { sink = Val(StrView(str_utf8, n)).as_handle(); });
+        bench(results, utf8_names[s][1], [&] {
+            String str(Val(StrView(str_utf8, n)));
+            sink = static_cast<uint32_t>(str.c_str()[0]);
+        });
+    }
+}
+
+void run_array_benches(const Val &results) {
+    for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); ++i)
+        ints[i] = static_cast<int32_t>(i);
+    static const char *const names[][2] = {
+        {"from_span_16", "vec_from_js_array_16"},
+        {"from_span_1024", "vec_from_js_array_1024"},
+        {"from_span_65536", "vec_from_js_array_65536"},
+    };
+    for (size_t s = 0; s < sizeof(array_sizes) / sizeof(array_sizes[0]); ++s) {
+        size_t n = array_sizes[s];
+        bench(results, names[s][0], [&] { sink = Val::from_span(ints, n).as_handle(); });
+        auto arr = Val::from_span(ints, n);
+        bench(results, names[s][1], [&] {
+            size_t len = 0;
+            auto v     = Val::vec_from_js_array<int32_t>(arr, len);
+            sink       = static_cast<uint32_t>(v[len - 1]);
+        });
+    }
+}
+
+void run_refcount_benches(const Val &results) {
+    auto obj = Val::object();
+    bench(results, "refcount_copy_destroy", [&] {
+        Val copy(obj);
+        sink = copy.as_handle();
+    });
+    bench(results, "refcount_move", [&] {
+        Val copy(obj);
+        Val moved(static_cast<Val &&>(copy));
+        sink = moved.as_handle();
+    });
+}
+
+void run_await_benches(const Val &results) {
+    Val v(1);
+    bench(results, "await", [&] { sink = v.await().as_handle(); });
+}
+} // namespace
+
+int main() {
+    emlite::init();
+    auto results = Val::array();
+
+    run_property_benches(results);
+    run_call_benches(results);
+    run_function_benches(results);
+    run_string_benches(results);
+    run_array_benches(results);
+    run_refcount_benches(results);
+    run_await_benches(results);
+
+    auto json   = Val::intrinsic(Intrinsic::JSON).call("stringify", results);
+    auto report = Val::global("emliteBenchReport");
+    if (report.is_function())
+        report(json);
+    else
+        Console().log(json);
+}
@@ -0,0 +1,143 @@
+// Runs the boundary crossing benchmarks of bench/boundary.cpp and emits JSON,
+// so results can be compared across versions and toolchains.
+// Build the bench targets first, for every available toolchain:
+//   npm run build:tests
+// then:
+//   node bench/node_bench.js [--out results.json] [--compare baseline.json] [paths...]
+// Without paths, every bin/*/bench/bench_boundary.{wasm,js} is run.
+
+import fs from "node:fs";
+import path from "node:path";
+import { execFileSync } from "node:child_process";
+import { WASI } from "node:wasi";
+import { fileURLToPath } from "node:url";
+import { Emlite } from "../scripts/index.js";
+
+const ROOT = path.join(path.dirname(fileURLToPath(import.meta.url)), "..");
+// Progress and tables go to stderr, keeping stdout for the JSON
+const log = new console.Console(process.stderr);
+
+function parseArgs(argv) {
+  const opts = { out: null, compare: null, paths: [] };
+  for (let i = 0; i < argv.length; i++) {
+    if (argv[i] === "--out") opts.out = argv[++i];
+    else if (argv[i] === "--compare") opts.compare = argv[++i];
+    else opts.paths.push(argv[i]);
+  }
+  return opts;
+}
+
+function findTargets() {
+  const bin = path.join(ROOT, "bin");
+  if (!fs.existsSync(bin)) return [];
+  const found = [];
+  for (const dir of fs.readdirSync(bin)) {
+    for (const ext of [".wasm", ".js"]) {
+      const p = path.join(bin, dir, "bench", `bench_boundary${ext}`);
+      if (fs.existsSync(p)) found.push(p);
+    }
+  }
+  return found;
+}
+
+// The label of a build directory, e.g. bin/wasi_sdk/bench/bench_boundary.wasm -> wasi_sdk
+function targetName(p) {
+  return path.basename(path.dirname(path.dirname(path.resolve(p))));
+}
+
+// The emscripten glue runs main itself, the results are the JSON line on its stdout
+function runGlue(p) {
+  const out = execFileSync(process.execPath, [p], { encoding: "utf8" });
+  const line = out
+    .split("\n")
+    .reverse()
+    .find((l) => l.startsWith("["));
+  if (!line) throw new Error(`${p} printed no results`);
+  return JSON.parse(line);
+}
+
+async function runWasm(p) {
+  let report = null;
+  const emlite = new Emlite({
+    globals: { emliteBenchReport: (json) => (report = JSON.parse(json)) },
+  });
+  const bytes = await emlite.readFile(p);
+  const wasm = await WebAssembly.compile(bytes);
+  const usesWasi = WebAssembly.Module.imports(wasm).some(
+    (i) => i.module === "wasi_snapshot_preview1"
+  );
+  if (usesWasi) {
+    const wasi = new WASI({ version: "preview1", args: [p], env: {} });
+    const instance = await WebAssembly.instantiate(wasm, {
+      wasi_snapshot_preview1: wasi.wasiImport,
+      env: emlite.env,
+    });
+    emlite.setExports(instance.exports);
+    wasi.start(instance);
+  } else {
+    const instance = await WebAssembly.instantiate(wasm, { env: emlite.env });
+    emlite.setExports(instance.exports);
+    instance.exports.main();
+  }
+  if (!report) throw new Error(`${p} reported no results`);
+  return report;
+}
+
+// Prints the ratio of each ns/op to the baseline's, for the targets both runs have
+function compare(baseline, current) {
+  const rows = [];
+  for (const target of current.targets) {
+    const base = baseline.targets.find((t) => t.name === target.name);
+    if (!base) continue;
+    for (const r of target.results) {
+      const b = base.results.find((x) => x.name === r.name);
+      if (!b) continue;
+      rows.push({
+        target: target.name,
+        bench: r.name,
+        "base ns/op": +b.ns_per_op.toFixed(1),
+        "ns/op": +r.ns_per_op.toFixed(1),
+        change: `${(((r.ns_per_op - b.ns_per_op) / b.ns_per_op) * 100).toFixed(1)}%`,
+      });
+    }
+  }
+  log.error(`Compared with ${baseline.version} (${baseline.date})`);
+  log.table(rows);
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  const paths = opts.paths.length ? opts.paths : findTargets();
+  if (!paths.length) {
+    log.error("No bench_boundary builds found, run `npm run build:tests` first");
+    process.exit(1);
+  }
+
+  const pkg = JSON.parse(fs.readFileSync(path.join(ROOT, "package.json"), "utf8"));
+  const run = {
+    version: pkg.version,
+    node: process.version,
+    date: new Date().toISOString(),
+    targets: [],
+  };
+  for (const p of paths) {
+    log.error(`▶  ${p}`);
+    const results = p.endsWith(".js") ? runGlue(p) : await runWasm(p);
+    run.targets.push({ name: targetName(p), results });
+    log.table(
+      results.map((r) => ({
+        bench: r.name,
+        "ns/op": +r.ns_per_op.toFixed(1),
+        "ops/s": Math.round(r.ops_per_sec),
+      }))
+    );
+  }
+
+  const json = JSON.stringify(run, null, 2);
+  if (opts.out) fs.writeFileSync(opts.out, json + "\n");
+  else process.stdout.write(json + "\n");
+
+  if (opts.compare) compare(JSON.parse(fs.readFileSync(opts.compare, "utf8")), run);
+}
+
+await main();
@@ -0,0 +1,120 @@
+// Compares the emcore allocators (bump and dlmalloc) with the slab allocator of
+// src/slab.cpp: throughput and memory growth over emlite's allocation profiles,
+// and the .wasm size of each freestanding build. Emits JSON like node_bench.js.
+// Build the freestanding sets first:
+//   npm run build:tests
+// then:
+//   node bench/node_bench_alloc.js [--out results.json]
+
+import fs from "node:fs";
+import path from "node:path";
+import { fileURLToPath } from "node:url";
+import { Emlite } from "../scripts/index.js";
+
+const ROOT = path.join(path.dirname(fileURLToPath(import.meta.url)), "..");
+const log = new console.Console(process.stderr);
+
+// Build directories and the backend emlite_malloc maps to in each
+const BUILDS = [
+  { dir: "freestanding", backend: "bump" },
+  { dir: "freestanding_dl", backend: "dlmalloc" },
+  { dir: "freestanding_slab", backend: "bump" },
+];
+const PATTERNS = ["closures", "handles", "strings", "mixed"];
+const OPS = 1 << 20;
+// Targets whose size is reported, besides the benchmark itself
+const SIZE_TARGETS = ["bench/bench_alloc.wasm", "examples/dom_simple.wasm"];
+
+function parseArgs(argv) {
+  const opts = { out: null };
+  for (let i = 0; i < argv.length; i++) if (argv[i] === "--out") opts.out = argv[++i];
+  return opts;
+}
+
+// Every run gets a fresh instance, so memory growth is its own
+async function instantiate(wasm) {
+  const emlite = new Emlite();
+  const instance = await WebAssembly.instantiate(wasm, { env: emlite.env });
+  emlite.setExports(instance.exports);
+  instance.exports.main();
+  return instance.exports;
+}
+
+async function runBuild(build, wasmPath) {
+  const wasm = await WebAssembly.compile(fs.readFileSync(wasmPath));
+  const results = [];
+  for (const [allocator, name] of [build.backend, "slab"].entries()) {
+    for (let p = 0; p < PATTERNS.length; p++) {
+      const ex = await instantiate(wasm);
+      const before = ex.memory.buffer.byteLength;
+      const start = performance.now();
+      const peak = Number(ex.bench_alloc_run(allocator, p, OPS));
+      const ms = performance.now() - start;
+      if (!peak) throw new Error(`${wasmPath}: ${name} ran out of memory`);
+      const grown = ex.memory.buffer.byteLength - before;
+      results.push({
+        allocator: name,
+        pattern: PATTERNS[p],
+        ns_per_op: (ms * 1e6) / OPS,
+        peak_live: peak,
+        memory_grown: grown,
+        slab_footprint: allocator ? Number(ex.bench_alloc_slab_footprint()) : null,
+        // Memory grown per byte live at the peak, the static data aside
+        overhead: grown / peak,
+      });
+    }
+  }
+  return results;
+}
+
+function wasmSizes(dir) {
+  const sizes = {};
+  for (const t of SIZE_TARGETS) {
+    const p = path.join(ROOT, "bin", dir, t);
+    if (fs.existsSync(p)) sizes[path.basename(t)] = fs.statSync(p).size;
+  }
+  return sizes;
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  const pkg = JSON.parse(fs.readFileSync(path.join(ROOT, "package.json"), "utf8"));
+  const run = {
+    version: pkg.version,
+    node: process.version,
+    date: new Date().toISOString(),
+    targets: [],
+  };
+  for (const build of BUILDS) {
+    const wasmPath = path.join(ROOT, "bin", build.dir, "bench", "bench_alloc.wasm");
+    if (!fs.existsSync(wasmPath)) {
+      log.error(`Skipping ${build.dir}, ${wasmPath} not found`);
+      continue;
+    }
+    log.error(`▶  ${build.dir}`);
+    const results = await runBuild(build, wasmPath);
+    const sizes = wasmSizes(build.dir);
+    run.targets.push({ name: build.dir, sizes, results });
+    log.table(
+      results.map((r) => ({
+        allocator: r.allocator,
+        pattern: r.pattern,
+        "ns/op": +r.ns_per_op.toFixed(1),
+        "peak live KiB": Math.round(r.peak_live / 1024),
+        "grown KiB": Math.round(r.memory_grown / 1024),
+        overhead: +r.overhead.toFixed(2),
+      }))
+    );
+    log.error("wasm sizes:", sizes);
+  }
+  if (!run.targets.length) {
+    log.error("No bench_alloc builds found, run `npm run build:tests` first");
+    process.exit(1);
+  }
+
+  const json = JSON.stringify(run, null, 2);
+  if (opts.out) fs.writeFileSync(opts.out, json + "\n");
+  else process.stdout.write(json + "\n");
+}
+
+await main();
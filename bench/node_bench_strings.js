@@ -0,0 +1,58 @@
+// Measures string transcoding throughput over ASCII, mixed and CJK corpora.
+// Build with -DEMLITE_BUILD_BENCH=ON (and -DEMLITE_SIMD128=ON for the simd kernels):
+//   cmake -Bbin/freestanding -DCMAKE_TOOLCHAIN_FILE=./cmake/freestanding.cmake -DEMLITE_BUILD_BENCH=ON
+//   cmake --build bin/freestanding
+//   node bench/node_bench_strings.js [path/to/bench_strings.wasm]
+
+import { Emlite } from "../scripts/index.js";
+
+const CORPORA = ["ascii", "mixed", "cjk"];
+const SIZES = [8, 16, 1024, 65536];
+const BENCHES = [
+  "bench_make_str",
+  "bench_make_str_ascii",
+  "bench_make_str_generic",
+  "bench_validate_utf8",
+  "bench_utf8_to_utf16",
+  "bench_utf16_to_utf8",
+  "bench_utf16_length_from_utf8",
+];
+// Roughly the number of bytes processed per measurement
+const BUDGET = 64 << 20;
+
+async function main() {
+  const path =
+    process.argv[2] ?? new URL("../bin/freestanding/bench/bench_strings.wasm", import.meta.url);
+  const emlite = new Emlite();
+  const bytes = await emlite.readFile(path);
+  const wasm = await WebAssembly.compile(bytes);
+  const instance = await WebAssembly.instantiate(wasm, { env: emlite.env });
+  emlite.setExports(instance.exports);
+  const ex = instance.exports;
+  ex.main();
+
+  const rows = [];
+  for (let c = 0; c < CORPORA.length; c++) {
+    for (const size of SIZES) {
+      const len = Number(ex.bench_str_setup(c, size));
+      const iters = Math.max(1, Math.floor(BUDGET / len));
+      for (const name of BENCHES) {
+        if (name === "bench_make_str_ascii" && CORPORA[c] !== "ascii") continue;
+        ex[name](Math.max(1, iters >> 4)); // warm up
+        const start = performance.now();
+        ex[name](iters);
+        const ms = performance.now() - start;
+        rows.push({
+          corpus: CORPORA[c],
+          bytes: len,
+          bench: name,
+          "MB/s": +((len * iters) / 1e3 / ms).toFixed(1),
+          "ns/op": +((ms * 1e6) / iters).toFixed(1),
+        });
+      }
+    }
+  }
+  console.table(rows);
+}
+
+await main();
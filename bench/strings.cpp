@@ -0,0 +1,99 @@
+#include "utf.hpp"
+#include <emlite/emlite.hpp>
+
+using namespace emlite;
+
+// String transcoding benchmark, driven by bench/node_bench_strings.js.
+// A corpus sample is repeated into a buffer of the requested size, then each
+// entry point runs `iters` times over it so the runner can time it.
+
+namespace {
+constexpr size_t max_size = 1 << 20;
+char buf8[max_size];
+char16_t buf16[max_size];
+char out8[max_size * 3];
+size_t len8  = 0;
+size_t len16 = 0;
+
+const char *const corpora[] = {
+    // ASCII
+    "The quick brown fox jumps over the lazy dog. ",
+    // Mixed Latin with accents, punctuation and the odd emoji
+    "Gr\xC3\xBC\xC3\x9F" "e aus K\xC3\xB6ln, \xC3\xA7" "a va? Se\xC3\xB1or \xE2\x80\x94 "
+    "na\xC3\xAFve caf\xC3\xA9 \xF0\x9F\x98\x80. ",
+    // CJK
+    "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x81\xAE\xE3\x83\x86\xE3\x82\xAD\xE3\x82\xB9"
+    "\xE3\x83\x88\xE3\x81\xA8\xE4\xB8\xAD\xE6\x96\x87\xE6\x96\x87\xE6\x9C\xAC\xE3\x80\x82",
+};
+} // namespace
+
+/// Fills the buffers with `size` bytes of a corpus, 0 ASCII, 1 mixed, 2 CJK
+/// @returns the size in bytes, trimmed to a whole number of samples
+EMLITE_USED extern "C" size_t bench_str_setup(int corpus, size_t size) {
+    const char *sample = corpora[corpus];
+    size_t n           = strlen(sample);
+    if (size > max_size)
+        size = max_size;
+    len8 = 0;
+    while (len8 + n <= size) {
+        for (size_t i = 0; i < n; ++i)
+            buf8[len8 + i] = sample[i];
+        len8 += n;
+    }
+    if (!len8) {
+        for (size_t i = 0; i < n && i < size; ++i)
+            buf8[len8++] = sample[i];
+    }
+    len16 = utf::utf8_to_utf16(buf8, len8, buf16);
+    return len8;
+}
+
+/// Creates a javascript string from the buffer through the Val path,
+/// which picks the ASCII import for short ASCII strings
+EMLITE_USED extern "C" void bench_make_str(int iters) {
+    for (int i = 0; i < iters; ++i)
+        emlite_val_dec_ref(detail::make_str(buf8, len8));
+}
+
+/// Creates a javascript string from the buffer through the ASCII import,
+/// without scanning it, for ASCII corpora only
+EMLITE_USED extern "C" void bench_make_str_ascii(int iters) {
+    for (int i = 0; i < iters; ++i)
+        emlite_val_dec_ref(emlite_val_make_str_ascii(buf8, len8));
+}
+
+/// Creates a javascript string from the buffer through the generic UTF-8 import
+EMLITE_USED extern "C" void bench_make_str_generic(int iters) {
+    for (int i = 0; i < iters; ++i)
+        emlite_val_dec_ref(emlite_val_make_str(buf8, len8));
+}
+
+EMLITE_USED extern "C" int bench_validate_utf8(int iters) {
+    int ok = 0;
+    for (int i = 0; i < iters; ++i)
+        ok += utf::validate_utf8(buf8, len8);
+    return ok;
+}
+
+EMLITE_USED extern "C" size_t bench_utf8_to_utf16(int iters) {
+    size_t n = 0;
+    for (int i = 0; i < iters; ++i)
+        n += utf::utf8_to_utf16(buf8, len8, buf16);
+    return n;
+}
+
+EMLITE_USED extern "C" size_t bench_utf16_to_utf8(int iters) {
+    size_t n = 0;
+    for (int i = 0; i < iters; ++i)
+        n += utf::utf16_to_utf8(buf16, len16, out8);
+    return n;
+}
+
+EMLITE_USED extern "C" size_t bench_utf16_length_from_utf8(int iters) {
+    size_t n = 0;
+    for (int i = 0; i < iters; ++i)
+        n += utf::utf16_length_from_utf8(buf8, len8);
+    return n;
+}
+
+int main() { emlite::init(); }
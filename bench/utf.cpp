@@ -0,0 +1,242 @@
+#include "utf.hpp"
+
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+namespace utf {
+namespace {
+using u8 = unsigned char;
+
+inline size_t popcount(int mask) noexcept { return static_cast<size_t>(__builtin_popcount(mask)); }
+
+inline bool is_high_surrogate(uint32_t c) noexcept { return c >= 0xD800 && c <= 0xDBFF; }
+
+inline bool is_low_surrogate(uint32_t c) noexcept { return c >= 0xDC00 && c <= 0xDFFF; }
+} // namespace
+
+bool is_ascii(const char *str, size_t len) noexcept {
+    auto s   = reinterpret_cast<const u8 *>(str);
+    size_t i = 0;
+#ifdef __wasm_simd128__
+    for (; i + 16 <= len; i += 16) {
+        if (wasm_i8x16_bitmask(wasm_v128_load(s + i)))
+            return false;
+    }
+#endif
+    u8 acc = 0;
+    for (; i < len; ++i)
+        acc |= s[i];
+    return acc < 0x80;
+}
+
+bool is_latin1(const char16_t *s, size_t len) noexcept {
+    size_t i = 0;
+#ifdef __wasm_simd128__
+    const v128_t max = wasm_u16x8_splat(0xFF);
+    for (; i + 8 <= len; i += 8) {
+        if (wasm_v128_any_true(wasm_u16x8_gt(wasm_v128_load(s + i), max)))
+            return false;
+    }
+#endif
+    char16_t acc = 0;
+    for (; i < len; ++i)
+        acc |= s[i];
+    return acc < 0x100;
+}
+
+bool validate_utf8(const char *str, size_t len) noexcept {
+    auto s   = reinterpret_cast<const u8 *>(str);
+    size_t i = 0;
+    while (i < len) {
+#ifdef __wasm_simd128__
+        if (i + 16 <= len && !wasm_i8x16_bitmask(wasm_v128_load(s + i))) {
+            i += 16;
+            continue;
+        }
+#endif
+        uint32_t c = s[i];
+        if (c < 0x80) {
+            ++i;
+            continue;
+        }
+        size_t n;
+        uint32_t min;
+        if ((c & 0xE0) == 0xC0) {
+            n   = 1;
+            c  &= 0x1F;
+            min = 0x80;
+        } else if ((c & 0xF0) == 0xE0) {
+            n   = 2;
+            c  &= 0x0F;
+            min = 0x800;
+        } else if ((c & 0xF8) == 0xF0) {
+            n   = 3;
+            c  &= 0x07;
+            min = 0x10000;
+        } else {
+            return false;
+        }
+        if (len - i - 1 < n)
+            return false;
+        for (size_t k = 1; k <= n; ++k) {
+            uint32_t cc = s[i + k];
+            if ((cc & 0xC0) != 0x80)
+                return false;
+            c = (c << 6) | (cc & 0x3F);
+        }
+        if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+            return false;
+        i += n + 1;
+    }
+    return true;
+}
+
+size_t utf16_length_from_utf8(const char *str, size_t len) noexcept {
+    auto s   = reinterpret_cast<const u8 *>(str);
+    size_t n = 0;
+    size_t i = 0;
+#ifdef __wasm_simd128__
+    // Every byte but continuation bytes (0x80-0xBF, below -64 as signed)
+    // starts a code unit, and 4-byte leads (0xF0 and up) start a surrogate pair
+    const v128_t cont = wasm_i8x16_splat(-65);
+    const v128_t lead4 = wasm_u8x16_splat(0xF0);
+    for (; i + 16 <= len; i += 16) {
+        v128_t v = wasm_v128_load(s + i);
+        n += popcount(wasm_i8x16_bitmask(wasm_i8x16_gt(v, cont)));
+        n += popcount(wasm_i8x16_bitmask(wasm_u8x16_ge(v, lead4)));
+    }
+#endif
+    for (; i < len; ++i) {
+        n += (s[i] & 0xC0) != 0x80;
+        n += s[i] >= 0xF0;
+    }
+    return n;
+}
+
+size_t utf8_length_from_utf16(const char16_t *s, size_t len) noexcept {
+    size_t n = 0;
+    size_t i = 0;
+#ifdef __wasm_simd128__
+    const v128_t sur_mask = wasm_u16x8_splat(0xF800);
+    const v128_t sur      = wasm_u16x8_splat(0xD800);
+    const v128_t two      = wasm_u16x8_splat(0x80);
+    const v128_t three    = wasm_u16x8_splat(0x800);
+#endif
+    while (i < len) {
+#ifdef __wasm_simd128__
+        if (i + 8 <= len) {
+            v128_t v = wasm_v128_load(s + i);
+            // Blocks without surrogates take 1, 2 or 3 bytes per unit
+            if (!wasm_v128_any_true(wasm_i16x8_eq(wasm_v128_and(v, sur_mask), sur))) {
+                n += 8;
+                n += popcount(wasm_i16x8_bitmask(wasm_u16x8_ge(v, two)));
+                n += popcount(wasm_i16x8_bitmask(wasm_u16x8_ge(v, three)));
+                i += 8;
+                continue;
+            }
+        }
+#endif
+        uint32_t c = s[i];
+        if (c < 0x80) {
+            n += 1;
+        } else if (c < 0x800) {
+            n += 2;
+        } else if (is_high_surrogate(c) && i + 1 < len && is_low_surrogate(s[i + 1])) {
+            n += 4;
+            ++i;
+        } else {
+            // BMP, or an unpaired surrogate replaced by U+FFFD
+            n += 3;
+        }
+        ++i;
+    }
+    return n;
+}
+
+size_t utf8_to_utf16(const char *str, size_t len, char16_t *dst) noexcept {
+    auto s   = reinterpret_cast<const u8 *>(str);
+    size_t i = 0;
+    size_t o = 0;
+    while (i < len) {
+#ifdef __wasm_simd128__
+        if (i + 16 <= len) {
+            v128_t v = wasm_v128_load(s + i);
+            if (!wasm_i8x16_bitmask(v)) {
+                wasm_v128_store(dst + o, wasm_u16x8_extend_low_u8x16(v));
+                wasm_v128_store(dst + o + 8, wasm_u16x8_extend_high_u8x16(v));
+                i += 16;
+                o += 16;
+                continue;
+            }
+        }
+#endif
+        uint32_t c = s[i];
+        size_t n   = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+        if (len - i < n) {
+            // Truncated sequence
+            dst[o++] = 0xFFFD;
+            break;
+        }
+        if (n == 1) {
+            dst[o++] = static_cast<char16_t>(c);
+        } else if (n == 2) {
+            dst[o++] = static_cast<char16_t>(((c & 0x1F) << 6) | (s[i + 1] & 0x3F));
+        } else if (n == 3) {
+            dst[o++] = static_cast<char16_t>(
+                ((c & 0x0F) << 12) | ((s[i + 1] & 0x3F) << 6) | (s[i + 2] & 0x3F)
+            );
+        } else {
+            c = ((c & 0x07) << 18) | ((s[i + 1] & 0x3F) << 12) | ((s[i + 2] & 0x3F) << 6) |
+                (s[i + 3] & 0x3F);
+            c -= 0x10000;
+            dst[o++] = static_cast<char16_t>(0xD800 + (c >> 10));
+            dst[o++] = static_cast<char16_t>(0xDC00 + (c & 0x3FF));
+        }
+        i += n;
+    }
+    return o;
+}
+
+size_t utf16_to_utf8(const char16_t *s, size_t len, char *out) noexcept {
+    auto dst = reinterpret_cast<u8 *>(out);
+    size_t i = 0;
+    size_t o = 0;
+#ifdef __wasm_simd128__
+    const v128_t two = wasm_u16x8_splat(0x80);
+#endif
+    while (i < len) {
+#ifdef __wasm_simd128__
+        if (i + 8 <= len) {
+            v128_t v = wasm_v128_load(s + i);
+            if (!wasm_v128_any_true(wasm_u16x8_ge(v, two))) {
+                wasm_v128_store64_lane(dst + o, wasm_u8x16_narrow_i16x8(v, v), 0);
+                i += 8;
+                o += 8;
+                continue;
+            }
+        }
+#endif
+        uint32_t c = s[i++];
+        if (c < 0x80) {
+            dst[o++] = static_cast<u8>(c);
+        } else if (c < 0x800) {
+            dst[o++] = static_cast<u8>(0xC0 | (c >> 6));
+            dst[o++] = static_cast<u8>(0x80 | (c & 0x3F));
+        } else {
+            if (is_high_surrogate(c) && i < len && is_low_surrogate(s[i])) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (s[i++] - 0xDC00);
+                dst[o++] = static_cast<u8>(0xF0 | (c >> 18));
+                dst[o++] = static_cast<u8>(0x80 | ((c >> 12) & 0x3F));
+            } else {
+                if (c >= 0xD800 && c <= 0xDFFF)
+                    c = 0xFFFD;
+                dst[o++] = static_cast<u8>(0xE0 | (c >> 12));
+            }
+            dst[o++] = static_cast<u8>(0x80 | ((c >> 6) & 0x3F));
+            dst[o++] = static_cast<u8>(0x80 | (c & 0x3F));
+        }
+    }
+    return o;
+}
+} // namespace utf
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <emcore/emcore.h>
+
+// String transcoding kernels measured by the strings benchmark, against the
+// TextEncoder and TextDecoder of the javascript side.
+// When built with -msimd128 (EMLITE_SIMD128), 16-byte blocks are processed
+// with wasm simd128 and ASCII runs take a fast path. Otherwise the scalar
+// versions are used.
+
+namespace utf {
+/// @returns whether all `len` bytes at s are ASCII
+bool is_ascii(const char *s, size_t len) noexcept;
+/// @returns whether all `len` code units at s fit in Latin-1 (are below 0x100)
+bool is_latin1(const char16_t *s, size_t len) noexcept;
+/// @returns whether s holds `len` bytes of well-formed UTF-8, rejecting
+/// overlong forms, surrogates and code points above U+10FFFF
+bool validate_utf8(const char *s, size_t len) noexcept;
+/// @returns the number of UTF-16 code units needed for valid UTF-8
+size_t utf16_length_from_utf8(const char *s, size_t len) noexcept;
+/// @returns the number of UTF-8 bytes needed for UTF-16, with unpaired
+/// surrogates counted as U+FFFD
+size_t utf8_length_from_utf16(const char16_t *s, size_t len) noexcept;
+/// Converts valid UTF-8 to UTF-16
+/// @param dst must hold utf16_length_from_utf8(s, len) code units
+/// @returns the number of code units written
+size_t utf8_to_utf16(const char *s, size_t len, char16_t *dst) noexcept;
+/// Converts UTF-16 to UTF-8, replacing unpaired surrogates by U+FFFD
+/// @param dst must hold utf8_length_from_utf16(s, len) bytes
+/// @returns the number of bytes written
+size_t utf16_to_utf8(const char16_t *s, size_t len, char *dst) noexcept;
+} // namespace utf
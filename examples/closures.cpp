@@ -0,0 +1,30 @@
+#include <emlite/emlite.hpp>
+
+using namespace emlite;
+
+// Creates and drops callbacks, used by tests/node_test_closures.js
+// to check that memory stays bounded.
+EMLITE_USED extern "C" int churn_closures(int count) {
+    int sum = 0;
+    for (int i = 0; i < count; i++) {
+        auto fn = Val::make_fn([i](auto) -> Val { return Val(i); });
+        sum += fn().as<int>() == i;
+        Val::dispose_fn(fn);
+    }
+    return sum;
+}
+
+// Creates callbacks without disposing them, so that their closures are only
+// freed once javascript garbage collects the functions.
+EMLITE_USED extern "C" int drop_closures(int count) {
+    int sum = 0;
+    for (int i = 0; i < count; i++) {
+        auto fn = Val::make_fn([i](auto) -> Val { return Val(i); });
+        sum += fn().as<int>() == i;
+    }
+    return sum;
+}
+
+int main() {
+    emlite::init();
+}
@@ -0,0 +1,25 @@
+#include <emlite/command_buffer.hpp>
+
+using namespace emlite;
+
+// Builds a list of a thousand items, recording the DOM mutations into a
+// CommandBuffer which replays them in a single crossing.
+int main() {
+    emlite::init();
+
+    auto body = Val::global("document").get("body");
+
+    CommandBuffer cmds;
+    auto list = cmds.create_element("ul");
+    cmds.set_attribute(list, "id", "items");
+    for (int i = 0; i < 1000; ++i) {
+        auto item = cmds.create_element("li");
+        cmds.set(item, "textContent", i);
+        cmds.set_attribute(item, "data-index", i);
+        cmds.append_child(list, item);
+    }
+    cmds.append_child(body, list);
+    cmds.flush();
+
+    Console().log(cmds.get(list).get("childElementCount"));
+}
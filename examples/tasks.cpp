@@ -0,0 +1,38 @@
+#include <emlite/emlite.hpp>
+#include <emlite/task.hpp>
+
+using namespace emlite;
+
+// Resolves after `ms` milliseconds
+Val sleep(int ms) {
+    return Val::intrinsic(Intrinsic::Promise).new_(Val::make_fn([ms](auto p) -> Val {
+        Val::global("setTimeout")(p.vals[0], Val(ms));
+        return Val::undefined();
+    }));
+}
+
+Task<int> delayed(int ms, int value) {
+    co_await sleep(ms);
+    co_return value;
+}
+
+// Fans out many concurrent operations, then awaits them all
+Task<> run() {
+    Console console;
+    Task<int> tasks[100] = {};
+    for (int i = 0; i < 100; ++i)
+        tasks[i] = delayed(100 - i, i);
+    int sum = 0;
+    for (auto &t : tasks)
+        sum += co_await t;
+    console.log(Val("sum of task results:"), Val(sum));
+
+    auto res = co_await Val::global("Promise").call("reject", Val("expected rejection"));
+    if (!res)
+        console.log(Val("rejected with:"), res.error());
+}
+
+int main() {
+    emlite::init();
+    run();
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+#include "emlite.hpp"
+
+namespace emlite {
+/// A growable array of numbers which carries its length, for bulk data
+/// crossing the boundary. Up to `Inline` elements are stored in the Buf
+/// itself, larger contents move to the heap, whose capacity doubles as it
+/// grows. Buf is move-only.
+///
+/// Arrays, TypedArrays and strings are copied from javascript straight into
+/// the storage, and the contents go back as a view of linear memory, as a
+/// copy, or by handing the storage over with detach().
+///
+///     auto samples = Buf<float>::from_js(input);
+///     for (size_t i = 0; i < samples.size(); ++i)
+///         samples[i] *= gain;
+///     output.call("set", samples.view());
+template <typename T, size_t Inline = 64 / sizeof(T)>
+class Buf {
+    static_assert(
+        detail::is_integral_v<T> || detail::is_floating_point_v<T>, "Buf elements must be numbers"
+    );
+
+    T *heap_    = nullptr;
+    size_t len_ = 0;
+    size_t cap_ = Inline;
+    T inline_[Inline ? Inline : 1];
+
+    static void copy(T *dst, const T *src, size_t n) noexcept {
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = src[i];
+    }
+
+    void move_from(Buf &other) noexcept {
+        heap_ = other.heap_;
+        len_  = other.len_;
+        cap_  = other.cap_;
+        if (!heap_)
+            copy(inline_, other.inline_, len_);
+        other.heap_ = nullptr;
+        other.len_  = 0;
+        other.cap_  = Inline;
+    }
+
+    void grow(size_t n) {
+        size_t cap = cap_ ? cap_ * 2 : 8;
+        reserve(cap > n ? cap : n);
+    }
+
+  public:
+    using value_type = T;
+
+    Buf() noexcept = default;
+    /// Copies `len` elements at ptr
+    Buf(const T *ptr, size_t len) { append(ptr, len); }
+    Buf(const Buf &)            = delete;
+    Buf &operator=(const Buf &) = delete;
+    Buf(Buf &&other) noexcept { move_from(other); }
+    Buf &operator=(Buf &&other) noexcept {
+        if (this != &other) {
+            delete[] heap_;
+            move_from(other);
+        }
+        return *this;
+    }
+    ~Buf() { delete[] heap_; }
+
+    /// Copies the numbers of a javascript Array or TypedArray
+    static Buf from_js(const Val &v) {
+        Buf b;
+        b.append_js(v);
+        return b;
+    }
+
+    /// Copies the UTF-8 encoding of a string, or of `String(v)`
+    static Buf from_utf8(const Val &v) {
+        Buf b;
+        b.append_utf8(v);
+        return b;
+    }
+
+    [[nodiscard]] T *data() noexcept { return heap_ ? heap_ : inline_; }
+    [[nodiscard]] const T *data() const noexcept { return heap_ ? heap_ : inline_; }
+    [[nodiscard]] size_t size() const noexcept { return len_; }
+    [[nodiscard]] size_t capacity() const noexcept { return cap_; }
+    [[nodiscard]] bool empty() const noexcept { return len_ == 0; }
+    [[nodiscard]] T *begin() noexcept { return data(); }
+    [[nodiscard]] T *end() noexcept { return data() + len_; }
+    [[nodiscard]] const T *begin() const noexcept { return data(); }
+    [[nodiscard]] const T *end() const noexcept { return data() + len_; }
+    T &operator[](size_t i) noexcept { return data()[i]; }
+    const T &operator[](size_t i) const noexcept { return data()[i]; }
+
+    /// Makes room for `n` elements without growing again
+    void reserve(size_t n) {
+        if (n <= cap_)
+            return;
+        auto p = new T[n];
+        copy(p, data(), len_);
+        delete[] heap_;
+        heap_ = p;
+        cap_  = n;
+    }
+
+    /// Resizes to `n` elements, the new ones being zeroed
+    void resize(size_t n) {
+        reserve(n);
+        auto d = data();
+        for (size_t i = len_; i < n; ++i)
+            d[i] = T();
+        len_ = n;
+    }
+
+    /// Resizes to `n` elements, leaving the new ones uninitialized, for
+    /// contents about to be written in bulk
+    void resize_for_overwrite(size_t n) {
+        reserve(n);
+        len_ = n;
+    }
+
+    void clear() noexcept { len_ = 0; }
+
+    void push_back(T v) {
+        if (len_ == cap_)
+            grow(len_ + 1);
+        data()[len_++] = v;
+    }
+
+    /// Appends `len` elements at ptr
+    void append(const T *ptr, size_t len) {
+        if (len_ + len > cap_)
+            grow(len_ + len);
+        copy(data() + len_, ptr, len);
+        len_ += len;
+    }
+
+    /// Appends the numbers of a javascript Array or TypedArray, copied into
+    /// the storage in a single crossing
+    /// @returns the number of elements appended
+    size_t append_js(const Val &v) {
+        auto n = v.get(EMLITE_ATOM("length")).template as<size_t>();
+        if (len_ + n > cap_)
+            grow(len_ + n);
+        n = v.copy_to(data() + len_, n);
+        len_ += n;
+        return n;
+    }
+
+    /// Appends the UTF-8 encoding of a string, or of `String(v)`. It is
+    /// written into the spare capacity, which takes a single crossing when
+    /// it fits, and a second one after growing otherwise. Without the runtime
+    /// imports, the string is read whole into a temporary copy first.
+    /// @returns the number of bytes appended
+    size_t append_utf8(const Val &v) {
+        static_assert(sizeof(T) == 1, "UTF-8 goes into a Buf of bytes");
+#if !EMLITE_HAVE_RUNTIME_IMPORTS
+        auto s   = detail::emlite_val_get_value_string(v.as_handle());
+        size_t n = s ? strlen(s) : 0;
+        append(reinterpret_cast<const T *>(s), n);
+        free(s);
+        return n;
+#else
+        auto h     = v.as_handle();
+        auto spare = cap_ - len_;
+        size_t n   = detail::emlite_val_str_utf8_into(h, reinterpret_cast<char *>(data() + len_), spare);
+        if (n > spare) {
+            grow(len_ + n);
+            detail::emlite_val_str_utf8_into(h, reinterpret_cast<char *>(data() + len_), n);
+        }
+        len_ += n;
+        return n;
+#endif
+    }
+
+    /// @returns a TypedArray aliasing the contents, without copying. Like
+    /// `Val::view_of`, it is detached by javascript if the wasm memory grows.
+    [[nodiscard]] Val view() const noexcept { return Val::view_of(data(), len_); }
+    /// @returns a TypedArray holding a copy of the contents
+    [[nodiscard]] Val to_js() const noexcept { return Val::typed_array(data(), len_); }
+    /// @returns a javascript string decoded from the UTF-8 contents
+    [[nodiscard]] Val to_string() const noexcept {
+        static_assert(sizeof(T) == 1, "UTF-8 comes from a Buf of bytes");
+        return Val(StrView(reinterpret_cast<const char *>(data()), len_));
+    }
+
+    /// Hands the storage over to javascript, leaving the Buf empty.
+    /// @returns a TypedArray of the contents, whose memory is freed once it
+    /// is garbage collected. Like `view()`, the TypedArray is detached by a
+    /// memory.grow, so it is meant to be consumed before wasm allocates again.
+    /// Inline contents are moved to the heap first. Builds without the runtime
+    /// imports, such as the wasip2 component, return a copy instead.
+    Val detach() {
+        if (!heap_) {
+            auto p = new T[len_ ? len_ : 1];
+            copy(p, inline_, len_);
+            heap_ = p;
+        }
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+        constexpr auto ctor  = detail::typed_array_intrinsic<T>();
+        void (*drop)(void *) = [](void *p) { delete[] static_cast<T *>(p); };
+        Handle dropidx       = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(drop));
+        auto v               = Val::take_ownership(
+            detail::emlite_val_typed_array_adopt(Val::intrinsic(ctor).as_handle(), heap_, len_, dropidx)
+        );
+#else
+        auto v = Val::typed_array(heap_, len_);
+        delete[] heap_;
+#endif
+        heap_ = nullptr;
+        len_  = 0;
+        cap_  = Inline;
+        return v;
+    }
+};
+
+namespace detail {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+template <typename T, size_t N>
+Column column_of(const char *key, Buf<T, N> &col, size_t rows) {
+    col.resize_for_overwrite(rows);
+    return Column{key, static_cast<uint32_t>(strlen(key)), field_kind<T>(), col.data()};
+}
+#else
+/// Reads the property of a row like the extraction loop of scripts/index.js
+template <typename T>
+T column_value(const Val &row, const char *key) {
+    if (row.is_null() || row.is_undefined())
+        return T();
+    auto v = row.get(key);
+    if constexpr (is_same_v<T, bool>)
+        return !!v;
+    else
+        return v.template as<T>();
+}
+#endif
+} // namespace detail
+
+template <typename... Ts, size_t... Ns>
+size_t Val::extract_columns(
+    const Val &array, const char *const (&keys)[sizeof...(Ts)], Buf<Ts, Ns> &...cols
+) {
+    auto rows = array.get(EMLITE_ATOM("length")).template as<size_t>();
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    size_t i  = 0;
+    detail::Column table[sizeof...(Ts)] = {detail::column_of(keys[i++], cols, rows)...};
+    detail::emlite_val_extract_columns(array.v_, table, sizeof...(Ts), rows);
+#else
+    // Without emlite_val_extract_columns, one get per row and column
+    (cols.resize_for_overwrite(rows), ...);
+    for (size_t r = 0; r < rows; ++r) {
+        auto row = array[static_cast<uint32_t>(r)];
+        size_t c = 0;
+        ((cols[r] = detail::column_value<Ts>(row, keys[c++])), ...);
+    }
+#endif
+    return rows;
+}
+} // namespace emlite
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "emlite.hpp"
+
+namespace emlite {
+/// Records fire-and-forget operations (property sets, method calls, element
+/// creation, appendChild...) into a compact binary stream in linear memory,
+/// which javascript replays in a single crossing on `flush()`. Without the
+/// runtime imports, the stream is replayed on the C++ side instead, one
+/// crossing per operation, so the buffer only saves the recording.
+///
+/// Objects created by the buffer are referred to by placeholder Refs, which can
+/// be used as targets and arguments of later commands before they exist.
+/// Operands which are Vals, OwnedVals, ValRefs or Atoms are recorded by handle,
+/// so they must stay alive until the flush. Numbers are recorded as int32 when
+/// they fit, as doubles otherwise; strings are copied into the stream.
+class CommandBuffer {
+  public:
+    /// A placeholder for an object created by a command. Commands recorded
+    /// before the next flush can use it, and `get` can resolve it between that
+    /// flush and the following one.
+    class Ref {
+        uint32_t slot_;
+        explicit Ref(uint32_t slot) noexcept : slot_(slot) {}
+        friend class CommandBuffer;
+    };
+
+  private:
+    // Opcodes and operand tags, must match emlite_cmd_flush in scripts/index.js
+    enum Op : uint32_t {
+        OpCreateElement,
+        OpSet,
+        OpCall,
+        OpAppendChild,
+        OpSetAttribute,
+    };
+    enum Tag : uint32_t {
+        TagUndefined,
+        TagNull,
+        TagFalse,
+        TagTrue,
+        TagInt,
+        TagDouble,
+        TagString,
+        TagHandle,
+        TagSlot,
+    };
+
+    uint32_t *words_    = nullptr;
+    size_t len_         = 0;
+    size_t cap_         = 0;
+    uint32_t id_;
+    uint32_t next_slot_ = 0;
+#if !EMLITE_HAVE_RUNTIME_IMPORTS
+    // The objects created by the last flush, replayed through the emcore imports
+    OwnedVal slots_;
+
+    void replay(const uint32_t *words, size_t len);
+#endif
+
+    void grow(size_t n);
+    void push(uint32_t w) {
+        if (len_ == cap_)
+            grow(1);
+        words_[len_++] = w;
+    }
+    void push_str(const char *s, size_t len);
+    void push_double(double d);
+
+    template <typename T>
+    void push_value(const T &v) {
+        using U = detail::remove_cvref_t<T>;
+        if constexpr (detail::is_same_v<U, Ref>) {
+            push(TagSlot);
+            push(v.slot_);
+        } else if constexpr (detail::has_as_handle_v<U>) {
+            push(TagHandle);
+            push(v.as_handle());
+        } else if constexpr (detail::is_same_v<U, bool>) {
+            push(v ? TagTrue : TagFalse);
+        } else if constexpr (detail::is_integral_v<U>) {
+            bool fits;
+            if constexpr (detail::is_signed_v<U>)
+                fits = v >= -2147483647 - 1 && v <= 2147483647;
+            else
+                fits = v <= 2147483647u;
+            if (fits) {
+                push(TagInt);
+                push(static_cast<uint32_t>(static_cast<int32_t>(v)));
+            } else {
+                push_double(static_cast<double>(v));
+            }
+        } else if constexpr (detail::is_floating_point_v<U>) {
+            push_double(static_cast<double>(v));
+        } else if constexpr (detail::is_same_v<U, decltype(nullptr)>) {
+            push(TagNull);
+        } else if constexpr (detail::is_same_v<U, StrView>) {
+            push_str(v.ptr, v.len);
+        } else {
+            // Character arrays and nul-terminated strings
+            StrView s(v);
+            push_str(s.ptr, s.len);
+        }
+    }
+
+    Ref next_ref() noexcept { return Ref(next_slot_++); }
+
+  public:
+    CommandBuffer() noexcept;
+    CommandBuffer(const CommandBuffer &)            = delete;
+    CommandBuffer &operator=(const CommandBuffer &) = delete;
+    ~CommandBuffer();
+
+    /// Records `document.createElement(tag)`
+    /// @returns a placeholder for the element
+    Ref create_element(StrView tag) {
+        auto r = next_ref();
+        push(OpCreateElement);
+        push(r.slot_);
+        push_str(tag.ptr, tag.len);
+        return r;
+    }
+
+    /// Records `target[key] = value`
+    template <typename T, typename K, typename V>
+    void set(const T &target, const K &key, const V &value) {
+        push(OpSet);
+        push_value(target);
+        push_value(key);
+        push_value(value);
+    }
+
+    /// Records `target[method](...args)`
+    /// @returns a placeholder for the result, which can be ignored
+    template <typename T, typename... Args>
+    Ref call(const T &target, StrView method, const Args &...args) {
+        auto r = next_ref();
+        push(OpCall);
+        push(r.slot_);
+        push_value(target);
+        push_str(method.ptr, method.len);
+        push(static_cast<uint32_t>(sizeof...(Args)));
+        (push_value(args), ...);
+        return r;
+    }
+
+    /// Records `parent.appendChild(child)`
+    template <typename P, typename C>
+    void append_child(const P &parent, const C &child) {
+        push(OpAppendChild);
+        push_value(parent);
+        push_value(child);
+    }
+
+    /// Records `target.setAttribute(name, value)`
+    template <typename T, typename V>
+    void set_attribute(const T &target, StrView name, const V &value) {
+        push(OpSetAttribute);
+        push_value(target);
+        push_str(name.ptr, name.len);
+        push_value(value);
+    }
+
+    /// Replays the recorded commands in a single crossing and clears the buffer.
+    /// The objects created by this flush can then be resolved with `get`.
+    /// The buffer is cleared even if a command throws, and commands mustn't
+    /// record into the buffer being flushed.
+    void flush();
+
+    /// Resolves a placeholder created before the last flush
+    [[nodiscard]] Val get(Ref r) const noexcept;
+
+    /// @returns the number of bytes recorded since the last flush
+    [[nodiscard]] size_t size() const noexcept { return len_ * sizeof(uint32_t); }
+    [[nodiscard]] bool empty() const noexcept { return len_ == 0; }
+};
+} // namespace emlite
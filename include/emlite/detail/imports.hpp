@@ -0,0 +1,104 @@
+#pragma once
+
+#include <emcore/emcore.h>
+
+// Imports provided by the emlite-cpp javascript runtime (scripts/index.js),
+// on top of the ones declared by emcore. They are resolved from the `env`
+// module like the rest of the emlite api.
+//
+// Modules which aren't instantiated by the Emlite loader of scripts/index.js,
+// wasip2 components and emscripten's default mode, build without them: there
+// EMLITE_HAVE_RUNTIME_IMPORTS is 0 and emlite falls back to the emcore imports.
+// CMake defines EMLITE_CORE_IMPORTS for emscripten's default mode.
+
+#if defined(EMLITE_WASIP2_COMPONENT) || defined(EMLITE_CORE_IMPORTS)
+#define EMLITE_HAVE_RUNTIME_IMPORTS 0
+#else
+#define EMLITE_HAVE_RUNTIME_IMPORTS 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Calls `obj[name](...argv)` where argv points to `argc` handles in linear
+/// memory, avoiding the creation of a javascript arguments array
+Handle emlite_val_obj_call_argv(
+    Handle obj, const char *name, size_t len, const Handle *argv, size_t argc
+);
+/// Calls `obj[key](...argv)` where key is a handle to the property key
+Handle emlite_val_obj_call_key_argv(Handle obj, Handle key, const Handle *argv, size_t argc);
+/// Calls `fn(...argv)`
+Handle emlite_val_func_call_argv(Handle fn, const Handle *argv, size_t argc);
+/// Calls `new ctor(...argv)`
+Handle emlite_val_construct_new_argv(Handle ctor, const Handle *argv, size_t argc);
+/// Creates `new ctor(memory.buffer, ptr, len)`, a TypedArray aliasing linear memory
+Handle emlite_val_typed_array_view(Handle ctor, const void *ptr, size_t len);
+/// Creates a TypedArray of type ctor holding a copy of `len` elements at ptr
+Handle emlite_val_typed_array_copy(Handle ctor, const void *ptr, size_t len);
+/// Creates a TypedArray view of `len` elements at ptr like emlite_val_typed_array_view,
+/// which takes ownership of the memory: `dropidx(ptr)` is called through the function
+/// table once the view is garbage collected
+Handle emlite_val_typed_array_adopt(Handle ctor, void *ptr, size_t len, Handle dropidx);
+/// Copies up to `cap` elements of the Array or TypedArray src into linear memory at dst,
+/// viewed as a TypedArray of type ctor
+/// @returns the number of elements copied
+size_t emlite_val_copy_to(Handle src, Handle ctor, void *dst, size_t cap);
+/// Creates a javascript function which, when invoked, writes up to `cap` argument handles
+/// into slot and calls `fidx(data, slot, argc)` through the function table. The owned
+/// handle returned by the callee becomes the function's return value.
+/// `dropidx(data)` is called once, on dispose or when the function is garbage collected.
+Handle emlite_val_make_closure(
+    Handle fidx, Handle dropidx, void *data, Handle *slot, size_t cap
+);
+/// Drops the data of a function created by emlite_val_make_closure
+void emlite_val_dispose_closure(Handle fn);
+/// Decrements the refcount of `n` handles stored at ptr
+void emlite_val_dec_ref_batch(const Handle *ptr, size_t n);
+/// Creates a string from `len` ASCII bytes without a TextDecoder, for short strings
+Handle emlite_val_make_str_ascii(const char *ptr, size_t len);
+/// Writes the UTF-8 encoding of a string to dst, if it fits in `cap` bytes.
+/// Values other than strings are converted with `String(v)`.
+/// @returns the length of the encoding, which is larger than cap if it didn't fit
+size_t emlite_val_str_utf8_into(Handle str, char *dst, size_t cap);
+/// Compares a string with `len` bytes of UTF-8 at ptr, by code point
+/// @returns -1, 0 or 1
+int emlite_val_str_compare(Handle str, const char *ptr, size_t len);
+/// @returns whether a string starts with `len` bytes of UTF-8 at ptr
+bool emlite_val_str_starts_with(Handle str, const char *ptr, size_t len);
+/// Attaches callbacks to `Promise.resolve(promise)` which call
+/// `fidx(data, value, fulfilled)` through the function table once it settles,
+/// value being an owned handle to the result or the rejection reason
+void emlite_val_promise_then(Handle promise, Handle fidx, void *data);
+/// Compiles an EMLITE_EVAL snippet into a function taking its printf-style
+/// placeholders as parameters
+Handle emlite_val_compile_eval(const char *src, size_t len);
+/// @returns the emlite::Kind of a value
+int emlite_val_kind(Handle h);
+/// Replays `len` words of emlite::CommandBuffer commands, keeping the objects
+/// they create as the slots of buffer `id`
+void emlite_cmd_flush(uint32_t id, const uint32_t *words, size_t len);
+/// @returns a handle to the object in a slot of buffer `id`
+Handle emlite_cmd_get(uint32_t id, uint32_t slot);
+/// Drops the slots of buffer `id`
+void emlite_cmd_release(uint32_t id);
+/// Compiles the reader and writer of an EMLITE_REFLECT struct of `size` bytes
+/// from its `count` fields, a table of emlite::detail::Field
+/// @returns a handle to the shape
+Handle emlite_val_shape_define(const void *fields, size_t count, size_t size);
+/// Creates an object of a shape from the struct at ptr
+Handle emlite_val_shape_make(Handle shape, const void *ptr);
+/// Writes the fields of an object into the struct of a shape at ptr
+void emlite_val_shape_read(Handle shape, Handle obj, void *ptr);
+/// Creates an Array of `n` objects of a shape from the structs at ptr
+Handle emlite_val_shape_make_array(Handle shape, const void *ptr, size_t n);
+/// Writes up to `cap` objects of an Array into the structs of a shape at ptr
+/// @returns the number of structs written
+size_t emlite_val_shape_read_array(Handle shape, Handle arr, void *ptr, size_t cap);
+/// Reads properties of the first `rows` objects of an Array into `ncols` columns,
+/// a table of emlite::detail::Column
+void emlite_val_extract_columns(Handle arr, const void *cols, size_t ncols, size_t rows);
+
+#ifdef __cplusplus
+}
+#endif
@@ -119,4 +119,58 @@ inline void swap(Uniq<T> &a, Uniq<T> &b) noexcept {
 template <class T>
 inline void swap(Uniq<T[]> &a, Uniq<T[]> &b) noexcept {
     a.swap(b);
-}
\ No newline at end of file
+}
+
+/// A Uniq array which may point into an emlite::Arena, whose memory is only
+/// reclaimed when the arena is rewound. Arrays allocated with new[] are deleted
+/// like Uniq does, arena arrays are left alone, so the elements of arena arrays
+/// must not need destruction.
+template <class T>
+class ArenaUniq;
+
+template <class T>
+class ArenaUniq<T[]> {
+    T *ptr_     = nullptr;
+    bool owned_ = false;
+
+  public:
+    using element_type = T;
+
+    constexpr ArenaUniq() noexcept = default;
+    constexpr ArenaUniq(decltype(nullptr)) noexcept {}
+    /// @param owned whether p was allocated with new[], rather than from an arena
+    ArenaUniq(T *p, bool owned) noexcept : ptr_(p), owned_(owned) {}
+    ArenaUniq(Uniq<T[]> &&other) noexcept : ptr_(other.release()), owned_(true) {}
+
+    ArenaUniq(const ArenaUniq &)            = delete;
+    ArenaUniq &operator=(const ArenaUniq &) = delete;
+
+    ArenaUniq(ArenaUniq &&other) noexcept : ptr_(other.ptr_), owned_(other.owned_) {
+        other.ptr_ = nullptr;
+    }
+
+    ArenaUniq &operator=(ArenaUniq &&other) noexcept {
+        if (this != &other) {
+            reset();
+            ptr_       = other.ptr_;
+            owned_     = other.owned_;
+            other.ptr_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~ArenaUniq() { reset(); }
+
+    void reset() noexcept {
+        if (ptr_ && owned_)
+            delete[] ptr_;
+        ptr_ = nullptr;
+    }
+
+    [[nodiscard]] T *get() const noexcept { return ptr_; }
+    /// @returns whether the array lives in an arena
+    [[nodiscard]] bool in_arena() const noexcept { return ptr_ && !owned_; }
+    [[nodiscard]] explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+    T &operator[](size_t i) const noexcept { return ptr_[i]; }
+};
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <emcore/emcore.h>
+
+#include "imports.hpp"
+
+// Opt-in boundary statistics (EMLITE_STATS).
+// When enabled, every import call emlite makes is counted by kind, along with
+// the handles owned by Vals and the bytes of strings and arrays copied across
+// the boundary. emlite calls the imports through the emlite::detail wrappers
+// of the same names below, which do the counting; direct calls to the imports
+// aren't counted. Without EMLITE_STATS, nothing is counted and
+// `emlite::stats()` stays zeroed.
+
+namespace emlite {
+/// The kinds of crossings counted by emlite::Stats.
+/// The values must match the names in `Emlite.stats()` of scripts/index.js.
+enum class Crossing : unsigned char {
+    Get,          ///< property reads
+    Set,          ///< property writes
+    Has,          ///< property checks
+    Call,         ///< method and function calls
+    New,          ///< constructor calls
+    Create,       ///< new empty objects and arrays
+    ToJs,         ///< numbers and bools passed to javascript
+    FromJs,       ///< numbers and bools read from javascript
+    StringToJs,   ///< strings created from linear memory
+    StringFromJs, ///< strings read into linear memory
+    TypeCheck,    ///< typeof, instanceof, kind and is_* queries
+    Compare,      ///< comparisons and string matching
+    Function,     ///< function creation and promise callbacks
+    TypedArray,   ///< typed array views and copies
+    Refcount,     ///< handle reference counting
+    Other,        ///< throw, command buffers...
+    Count,
+};
+
+/// Boundary statistics, see `emlite::stats()`.
+/// The layout is read by `Emlite.stats()` in scripts/index.js, all fields being
+/// 64-bit integers.
+struct Stats {
+    /// Total number of crossings
+    uint64_t crossings;
+    /// Number of handles which Vals took ownership of
+    uint64_t handles_created;
+    /// Number of handle references currently owned by Vals
+    int64_t live_handles;
+    /// The high-water mark of live_handles
+    int64_t peak_live_handles;
+    /// Bytes of strings and arrays copied into javascript
+    uint64_t bytes_to_js;
+    /// Bytes of strings and arrays copied out of javascript
+    uint64_t bytes_from_js;
+    /// Crossings of each kind, indexed by Crossing
+    uint64_t calls[static_cast<size_t>(Crossing::Count)];
+
+    /// @returns the number of crossings of a kind
+    [[nodiscard]] uint64_t count(Crossing k) const noexcept {
+        return calls[static_cast<size_t>(k)];
+    }
+};
+
+/// @returns the boundary statistics gathered since the start, or since the last
+/// reset_stats(). All zeros unless emlite is built with EMLITE_STATS.
+[[nodiscard]] const Stats &stats() noexcept;
+/// Resets the counters. live_handles is kept, and becomes the new peak.
+void reset_stats() noexcept;
+
+namespace detail {
+extern Stats stats_data;
+
+inline void stats_handle_acquired(Handle h, bool created) noexcept {
+#ifdef EMLITE_STATS
+    if (!h)
+        return;
+    if (created)
+        ++stats_data.handles_created;
+    if (++stats_data.live_handles > stats_data.peak_live_handles)
+        stats_data.peak_live_handles = stats_data.live_handles;
+#else
+    (void)h;
+    (void)created;
+#endif
+}
+
+inline void stats_handle_released(Handle h) noexcept {
+#ifdef EMLITE_STATS
+    if (h)
+        --stats_data.live_handles;
+#else
+    (void)h;
+#endif
+}
+
+#ifdef EMLITE_STATS
+template <typename P>
+struct pointee_size {
+    static constexpr size_t value = 1;
+};
+
+template <typename T>
+struct pointee_size<T *> {
+    static constexpr size_t value = sizeof(T);
+};
+
+template <>
+struct pointee_size<void *> {
+    static constexpr size_t value = 1;
+};
+
+template <>
+struct pointee_size<const void *> {
+    static constexpr size_t value = 1;
+};
+
+template <size_t I, typename T, typename... R>
+constexpr auto nth(T t, R... r) noexcept {
+    if constexpr (I == 0)
+        return t;
+    else
+        return nth<I - 1>(r...);
+}
+
+template <typename C>
+size_t cstr_bytes(const C *s) noexcept {
+    size_t n = 0;
+    if (s) {
+        while (s[n])
+            ++n;
+    }
+    return n * sizeof(C);
+}
+
+inline void stats_count(Crossing k) noexcept {
+    ++stats_data.crossings;
+    ++stats_data.calls[static_cast<size_t>(k)];
+}
+
+/// Calls an import
+template <Crossing K, typename F, typename... A>
+auto counted(F f, A... a) {
+    stats_count(K);
+    return f(a...);
+}
+
+/// Calls an import which copies the `a[I + 1]` elements at `a[I]` into javascript
+template <Crossing K, size_t I, typename F, typename... A>
+auto counted_to_js(F f, A... a) {
+    stats_count(K);
+    stats_data.bytes_to_js +=
+        static_cast<uint64_t>(nth<I + 1>(a...)) * pointee_size<decltype(nth<I>(a...))>::value;
+    return f(a...);
+}
+
+/// Calls an import returning a nul-terminated string allocated in linear memory
+template <Crossing K, typename F, typename... A>
+auto counted_cstr(F f, A... a) {
+    stats_count(K);
+    auto r = f(a...);
+    stats_data.bytes_from_js += cstr_bytes(r);
+    return r;
+}
+
+/// Calls an import which copies at most `a[I + 1]` elements into `a[I]`,
+/// and returns the number of elements available
+template <Crossing K, size_t I, typename F, typename... A>
+auto counted_from_js(F f, A... a) {
+    stats_count(K);
+    auto r   = f(a...);
+    auto cap = static_cast<uint64_t>(nth<I + 1>(a...));
+    auto n   = static_cast<uint64_t>(r) < cap ? static_cast<uint64_t>(r) : cap;
+    stats_data.bytes_from_js += n * pointee_size<decltype(nth<I>(a...))>::value;
+    return r;
+}
+#endif
+
+// The imports as called by emlite, with their crossing kind. The wrappers have
+// the names of the imports they call, without the EMLITE_STATS counting they
+// just forward to them. They are templates, so imports which aren't called
+// (the runtime ones without EMLITE_HAVE_RUNTIME_IMPORTS) are never referenced.
+#ifdef EMLITE_STATS
+#define EMLITE_COUNTED(kind, name)                                                                 \
+    template <typename... A>                                                                       \
+    inline auto name(A... a) {                                                                     \
+        return counted<Crossing::kind>(&::name, a...);                                             \
+    }
+#define EMLITE_COUNTED_TO_JS(kind, ptr_idx, name)                                                  \
+    template <typename... A>                                                                       \
+    inline auto name(A... a) {                                                                     \
+        return counted_to_js<Crossing::kind, ptr_idx>(&::name, a...);                              \
+    }
+#define EMLITE_COUNTED_FROM_JS(kind, ptr_idx, name)                                                \
+    template <typename... A>                                                                       \
+    inline auto name(A... a) {                                                                     \
+        return counted_from_js<Crossing::kind, ptr_idx>(&::name, a...);                            \
+    }
+#define EMLITE_COUNTED_CSTR(kind, name)                                                            \
+    template <typename... A>                                                                       \
+    inline auto name(A... a) {                                                                     \
+        return counted_cstr<Crossing::kind>(&::name, a...);                                        \
+    }
+#else
+#define EMLITE_COUNTED(kind, name)                                                                 \
+    template <typename... A>                                                                       \
+    inline auto name(A... a) {                                                                     \
+        return ::name(a...);                                                                       \
+    }
+#define EMLITE_COUNTED_TO_JS(kind, ptr_idx, name) EMLITE_COUNTED(kind, name)
+#define EMLITE_COUNTED_FROM_JS(kind, ptr_idx, name) EMLITE_COUNTED(kind, name)
+#define EMLITE_COUNTED_CSTR(kind, name) EMLITE_COUNTED(kind, name)
+#endif
+
+EMLITE_COUNTED(Get, emlite_val_get)
+EMLITE_COUNTED(Set, emlite_val_set)
+EMLITE_COUNTED(Has, emlite_val_has)
+EMLITE_COUNTED_TO_JS(Has, 1, emlite_val_obj_has_own_prop)
+EMLITE_COUNTED_TO_JS(Call, 1, emlite_val_obj_call)
+EMLITE_COUNTED_TO_JS(Call, 1, emlite_val_obj_call_argv)
+EMLITE_COUNTED(Call, emlite_val_obj_call_key_argv)
+EMLITE_COUNTED(Call, emlite_val_func_call)
+EMLITE_COUNTED(Call, emlite_val_func_call_argv)
+EMLITE_COUNTED(New, emlite_val_construct_new)
+EMLITE_COUNTED(New, emlite_val_construct_new_argv)
+EMLITE_COUNTED(Create, emlite_val_new_object)
+EMLITE_COUNTED(Create, emlite_val_new_array)
+EMLITE_COUNTED(Set, emlite_val_push)
+EMLITE_COUNTED(ToJs, emlite_val_make_int)
+EMLITE_COUNTED(ToJs, emlite_val_make_uint)
+EMLITE_COUNTED(ToJs, emlite_val_make_bigint)
+EMLITE_COUNTED(ToJs, emlite_val_make_biguint)
+EMLITE_COUNTED(ToJs, emlite_val_make_double)
+EMLITE_COUNTED(ToJs, emlite_val_make_bool)
+EMLITE_COUNTED(FromJs, emlite_val_get_value_int)
+EMLITE_COUNTED(FromJs, emlite_val_get_value_uint)
+EMLITE_COUNTED(FromJs, emlite_val_get_value_bigint)
+EMLITE_COUNTED(FromJs, emlite_val_get_value_biguint)
+EMLITE_COUNTED(FromJs, emlite_val_get_value_double)
+EMLITE_COUNTED_TO_JS(StringToJs, 0, emlite_val_make_str)
+EMLITE_COUNTED_TO_JS(StringToJs, 0, emlite_val_make_str_utf16)
+EMLITE_COUNTED_TO_JS(StringToJs, 0, emlite_val_make_str_ascii)
+EMLITE_COUNTED_CSTR(StringFromJs, emlite_val_get_value_string)
+EMLITE_COUNTED_CSTR(StringFromJs, emlite_val_get_value_string_utf16)
+EMLITE_COUNTED_FROM_JS(StringFromJs, 1, emlite_val_str_utf8_into)
+EMLITE_COUNTED(TypeCheck, emlite_val_is_string)
+EMLITE_COUNTED(TypeCheck, emlite_val_is_number)
+EMLITE_COUNTED(TypeCheck, emlite_val_is_bool)
+EMLITE_COUNTED_CSTR(TypeCheck, emlite_val_typeof)
+EMLITE_COUNTED(TypeCheck, emlite_val_instanceof)
+EMLITE_COUNTED(TypeCheck, emlite_val_kind)
+EMLITE_COUNTED(Compare, emlite_val_not)
+EMLITE_COUNTED(Compare, emlite_val_gt)
+EMLITE_COUNTED(Compare, emlite_val_gte)
+EMLITE_COUNTED(Compare, emlite_val_lt)
+EMLITE_COUNTED(Compare, emlite_val_lte)
+EMLITE_COUNTED(Compare, emlite_val_strictly_equals)
+EMLITE_COUNTED_TO_JS(Compare, 1, emlite_val_str_compare)
+EMLITE_COUNTED_TO_JS(Compare, 1, emlite_val_str_starts_with)
+EMLITE_COUNTED(Function, emlite_val_make_callback)
+EMLITE_COUNTED(Function, emlite_val_make_closure)
+EMLITE_COUNTED(Function, emlite_val_dispose_closure)
+EMLITE_COUNTED(Function, emlite_val_promise_then)
+EMLITE_COUNTED(Other, emlite_val_shape_define)
+EMLITE_COUNTED(Create, emlite_val_shape_make)
+EMLITE_COUNTED(FromJs, emlite_val_shape_read)
+EMLITE_COUNTED(Create, emlite_val_shape_make_array)
+EMLITE_COUNTED(FromJs, emlite_val_shape_read_array)
+EMLITE_COUNTED(FromJs, emlite_val_extract_columns)
+EMLITE_COUNTED_TO_JS(Function, 0, emlite_val_compile_eval)
+EMLITE_COUNTED(TypedArray, emlite_val_typed_array_view)
+EMLITE_COUNTED_TO_JS(TypedArray, 1, emlite_val_typed_array_copy)
+EMLITE_COUNTED(TypedArray, emlite_val_typed_array_adopt)
+EMLITE_COUNTED_FROM_JS(TypedArray, 2, emlite_val_copy_to)
+EMLITE_COUNTED(Refcount, emlite_val_inc_ref)
+EMLITE_COUNTED(Refcount, emlite_val_dec_ref)
+EMLITE_COUNTED(Refcount, emlite_val_dec_ref_batch)
+EMLITE_COUNTED(Other, emlite_val_throw)
+EMLITE_COUNTED_TO_JS(Other, 1, emlite_cmd_flush)
+EMLITE_COUNTED(Other, emlite_cmd_get)
+EMLITE_COUNTED(Other, emlite_cmd_release)
+
+#undef EMLITE_COUNTED
+#undef EMLITE_COUNTED_TO_JS
+#undef EMLITE_COUNTED_FROM_JS
+#undef EMLITE_COUNTED_CSTR
+} // namespace detail
+} // namespace emlite
@@ -20,6 +20,29 @@ struct remove_reference<T &&> {
 template <class T>
 using remove_reference_t = typename remove_reference<T>::type;
 
+template <typename T>
+struct remove_cv {
+    using type = T;
+};
+
+template <typename T>
+struct remove_cv<const T> {
+    using type = T;
+};
+
+template <typename T>
+struct remove_cv<volatile T> {
+    using type = T;
+};
+
+template <typename T>
+struct remove_cv<const volatile T> {
+    using type = T;
+};
+
+template <class T>
+using remove_cvref_t = typename remove_cv<remove_reference_t<T>>::type;
+
 template <typename T>
 constexpr T &&forward(typename remove_reference<T>::type &t) noexcept {
     return static_cast<T &&>(t);
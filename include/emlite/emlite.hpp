@@ -2,6 +2,9 @@
 
 #include <emcore/emcore.h>
 
+#include "detail/imports.hpp"
+#include "detail/stats.hpp"
+
 #if __has_include(<new>)
 #include <new>
 #define EMLITE_HAVE_STD_NEW 1
@@ -41,6 +44,16 @@ struct is_result<Result<T, E>> : true_type {};
 template <typename T>
 constexpr bool is_result_v = is_result<T>::value;
 
+// Detects types exposing their javascript handle through `as_handle()`
+template <typename T, typename = void>
+struct has_as_handle : false_type {};
+
+template <typename T>
+struct has_as_handle<T, void_t<decltype(declval<const T &>().as_handle())>> : true_type {};
+
+template <typename T>
+constexpr bool has_as_handle_v = has_as_handle<remove_cvref_t<T>>::value;
+
 template <typename... Args, size_t... I, typename F, typename P>
 constexpr decltype(auto) call_with_params_impl(F &&f, P &&p, index_sequence<I...>) {
     return forward<F>(f)(forward<P>(p).vals[I].template as<Args>()...);
@@ -63,21 +76,669 @@ using detail::some;
 using detail::ok;
 using detail::err;
 using detail::Uniq;
+using detail::ArenaUniq;
 
 void init();
+/// Releases the handles queued by the shadow refcount mode in a single crossing.
+/// This is a no-op unless emlite is built with EMLITE_SHADOW_REFCOUNT.
+void flush();
+
+namespace detail {
+#ifdef EMLITE_HANDLE_CENSUS
+// Census hooks of the refcount operations, see src/census.cpp
+void census_adopt(Handle h) noexcept;
+void census_retain(Handle h) noexcept;
+void census_release(Handle h) noexcept;
+void census_disown(Handle h) noexcept;
+void census_returned(Handle h) noexcept;
+#else
+inline void census_adopt(Handle) noexcept {}
+inline void census_retain(Handle) noexcept {}
+inline void census_release(Handle) noexcept {}
+inline void census_disown(Handle) noexcept {}
+inline void census_returned(Handle) noexcept {}
+#endif
+
+// Refcount operations shared by Val and OwnedVal. By default they cross into
+// javascript directly. With EMLITE_SHADOW_REFCOUNT, the refcounts of live handles
+// are tracked in linear memory and the handles which drop to zero are released
+// in batches, see src/refcount.cpp.
+#ifdef EMLITE_SHADOW_REFCOUNT
+/// Takes ownership of a handle freshly returned by javascript
+void handle_adopt(Handle h) noexcept;
+/// Adds an owner to a handle
+void handle_retain(Handle h) noexcept;
+/// Removes an owner from a handle
+void handle_release(Handle h) noexcept;
+/// Hands an owned reference over to javascript
+void handle_disown(Handle h) noexcept;
+#else
+inline void handle_adopt(Handle h) noexcept {
+    stats_handle_acquired(h, true);
+    census_adopt(h);
+}
+inline void handle_retain(Handle h) noexcept {
+    stats_handle_acquired(h, false);
+    census_retain(h);
+    emlite_val_inc_ref(h);
+}
+/// Removes an owner from a handle, deferred while a HandleScope is alive
+void handle_release(Handle h) noexcept;
+inline void handle_disown(Handle h) noexcept {
+    stats_handle_released(h);
+    census_disown(h);
+}
+#endif
+
+/// Creates a javascript string from UTF-8, taking the ASCII fast path for short strings
+Handle make_str(const char *s, size_t len) noexcept;
+} // namespace detail
+
+/// An RAII scope for bulk release of temporaries.
+/// While a HandleScope is alive, the handles released by Vals going out of
+/// scope are collected instead of being released one crossing at a time, and
+/// they are all released to javascript in a single crossing when the scope
+/// ends. Vals still alive at that point keep their handles, so results can
+/// simply be returned or moved out of the scope. Scopes can be nested.
+class HandleScope {
+    static constexpr size_t inline_size = 64;
+
+    HandleScope *prev_;
+    Handle *buf_;
+    size_t len_;
+    size_t cap_;
+    Handle inline_[inline_size];
+
+    static HandleScope *top_;
+    void defer(Handle h) noexcept;
+    friend void detail::handle_release(Handle h) noexcept;
+
+  public:
+    HandleScope() noexcept;
+    HandleScope(const HandleScope &)            = delete;
+    HandleScope &operator=(const HandleScope &) = delete;
+    /// Releases the collected handles
+    ~HandleScope();
+    /// Releases the handles collected so far, without ending the scope
+    void flush() noexcept;
+};
+
+/// Tags the handles which Vals take ownership of while it is alive, for the
+/// handle census of debug builds (EMLITE_HANDLE_CENSUS). Sites nest, the
+/// innermost one applies. Without EMLITE_HANDLE_CENSUS this does nothing.
+///
+///     emlite::HandleSite site("render");
+class HandleSite {
+#ifdef EMLITE_HANDLE_CENSUS
+    const char *name_;
+    const char *file_;
+    int line_;
+    HandleSite *prev_;
+
+    static HandleSite *top_;
+
+  public:
+    /// @param name a static string naming the site
+    explicit HandleSite(
+        const char *name, const char *file = __builtin_FILE(), int line = __builtin_LINE()
+    ) noexcept
+        : name_(name), file_(file), line_(line), prev_(top_) {
+        top_ = this;
+    }
+    ~HandleSite() { top_ = prev_; }
+
+    /// @returns the innermost site, or null
+    static const HandleSite *current() noexcept { return top_; }
+    [[nodiscard]] const char *name() const noexcept { return name_; }
+    [[nodiscard]] const char *file() const noexcept { return file_; }
+    [[nodiscard]] int line() const noexcept { return line_; }
+#else
+  public:
+    explicit HandleSite(const char *, const char * = nullptr, int = 0) noexcept {}
+#endif
+    HandleSite(const HandleSite &)            = delete;
+    HandleSite &operator=(const HandleSite &) = delete;
+};
+
+/// A point in time of the handle census, to list the handles created since
+struct HandleSnapshot {
+    /// The number of handles created before the snapshot
+    uint64_t created = 0;
+    /// The number of live handles at the snapshot
+    size_t live = 0;
+};
+
+/// The live handles created at a HandleSite
+struct HandleSiteCount {
+    /// The name, file and line of the site, or "<untagged>" and null
+    const char *name;
+    const char *file;
+    int line;
+    /// Handles owned by Vals
+    size_t live;
+    /// Handles handed over to javascript by `Val::release_handle`, which nothing
+    /// took ownership of since. Pinned objects show up here, but so can handles
+    /// which javascript has dropped since. The return values of closures
+    /// aren't counted, javascript drops them after the call.
+    size_t released;
+    /// The age of the oldest handle, in number of handles created after it
+    uint64_t oldest_age;
+};
+
+/// @returns a snapshot of the handle census, empty without EMLITE_HANDLE_CENSUS
+[[nodiscard]] HandleSnapshot snapshot_handles() noexcept;
+/// Groups the live handles created since a snapshot (or all of them) by site.
+/// Only handles owned through Val and OwnedVal are tracked, not the ones
+/// refcounted manually with emlite_val_inc_ref.
+/// @param[out] len the number of sites, 0 without EMLITE_HANDLE_CENSUS
+/// @returns the sites, by decreasing number of live handles
+Uniq<HandleSiteCount[]> live_handle_sites(size_t &len, HandleSnapshot since = {});
+/// Logs the live handles created since a snapshot (or all of them) to the
+/// console as a table grouped by site, with the change in their number.
+/// Does nothing without EMLITE_HANDLE_CENSUS.
+void dump_live_handles(HandleSnapshot since = {});
+
+/// A bump allocator for temporaries which die together, typically within a
+/// frame or an event handler. Memory is taken in blocks which are kept when the
+/// arena is rewound, so a steady frame loop stops allocating after its first
+/// frames. Nothing is destroyed on rewind, only trivially destructible objects
+/// belong in an arena.
+class Arena {
+    struct Block {
+        Block *next;
+        size_t size;
+    };
+
+    Block *first_ = nullptr;
+    Block *cur_   = nullptr;
+    char *ptr_    = nullptr;
+    char *end_    = nullptr;
+    size_t block_size_;
+
+    void *allocate_slow(size_t size, size_t align) noexcept;
+
+  public:
+    /// A position of the arena to rewind to
+    struct Mark {
+        Block *block;
+        char *ptr;
+    };
+
+    /// @param block_size the size of the blocks taken from the heap
+    explicit Arena(size_t block_size = 16384) noexcept : block_size_(block_size) {}
+    Arena(const Arena &)            = delete;
+    Arena &operator=(const Arena &) = delete;
+    /// Frees the blocks
+    ~Arena();
+
+    /// @param align a power of two
+    /// @returns uninitialized memory, valid until the arena is rewound past it
+    void *allocate(size_t size, size_t align = 16) noexcept {
+        auto p = reinterpret_cast<char *>(
+            (reinterpret_cast<uintptr_t>(ptr_) + align - 1) & ~static_cast<uintptr_t>(align - 1)
+        );
+        if (p && p + size <= end_) {
+            ptr_ = p + size;
+            return p;
+        }
+        return allocate_slow(size, align);
+    }
+
+    /// @returns an uninitialized array of `n` T
+    template <typename T>
+    T *allocate_array(size_t n) noexcept {
+        return static_cast<T *>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    /// @returns the bytes left in the current block
+    [[nodiscard]] size_t available() const noexcept { return static_cast<size_t>(end_ - ptr_); }
+    [[nodiscard]] Mark mark() const noexcept { return Mark{cur_, ptr_}; }
+    /// Frees everything allocated since `m`, keeping the blocks for reuse
+    void rewind(Mark m) noexcept;
+    /// Frees everything, keeping the blocks for reuse
+    void reset() noexcept { rewind(Mark{}); }
+    /// @returns the bytes of the blocks taken from the heap
+    [[nodiscard]] size_t capacity() const noexcept;
+
+    /// @returns the arena of the innermost FrameScope, or null
+    static Arena *current() noexcept;
+    /// @returns the arena used by default constructed FrameScopes
+    static Arena &frame() noexcept;
+};
+
+/// An RAII scope making an arena the target of emlite's temporaries: the
+/// arrays of `Val::vec_from_js_array`, the strings of `as<ArenaUniq<char[]>>()`
+/// and the formatting buffer of `emlite_eval_cpp`. The arena is rewound to
+/// where it was when the scope ends, so the temporaries allocated within the
+/// scope must not escape it. Scopes nest.
+///
+///     void on_event(Handle ev) {
+///         emlite::FrameScope frame;
+///         auto name = Val(ev)["type"].as<ArenaUniq<char[]>>();
+///         ...
+///     }
+class FrameScope {
+    Arena &arena_;
+    Arena::Mark mark_;
+    FrameScope *prev_;
+
+    static FrameScope *top_;
+    friend class Arena;
+
+  public:
+    /// Uses Arena::frame()
+    FrameScope() noexcept : FrameScope(Arena::frame()) {}
+    explicit FrameScope(Arena &arena) noexcept
+        : arena_(arena), mark_(arena.mark()), prev_(top_) {
+        top_ = this;
+    }
+    FrameScope(const FrameScope &)            = delete;
+    FrameScope &operator=(const FrameScope &) = delete;
+    ~FrameScope() {
+        arena_.rewind(mark_);
+        top_ = prev_;
+    }
+
+    [[nodiscard]] Arena &arena() const noexcept { return arena_; }
+};
+
+namespace detail {
+/// Copies a string, or `String(v)`, as UTF-8 into the arena of the innermost
+/// FrameScope, or to the heap outside of one
+ArenaUniq<char[]> arena_str(Handle h) noexcept;
+} // namespace detail
 
 class Val;
+template <typename T, size_t Inline>
+class Buf;
+
+/// A UTF-8 string which carries its length, so it is never rescanned.
+/// Strings passed as StrView go to javascript without a strlen.
+struct StrView {
+    const char *ptr = nullptr;
+    size_t len      = 0;
+
+    constexpr StrView() noexcept = default;
+    /// Views `len` bytes at ptr
+    constexpr StrView(const char *ptr, size_t len) noexcept : ptr(ptr), len(len) {}
+    /// Views a character array up to its nul terminator. For string literals
+    /// the length is folded at compile time.
+    template <size_t N>
+    constexpr StrView(const char (&s)[N]) noexcept : ptr(s), len(__builtin_strlen(s)) {}
+    /// Views a nul-terminated string, computing its length once
+    explicit StrView(const char *s) noexcept : ptr(s), len(s ? strlen(s) : 0) {}
+};
+
+/// A UTF-16 string which carries its length, in code units
+struct U16StrView {
+    const char16_t *ptr = nullptr;
+    size_t len          = 0;
+
+    constexpr U16StrView() noexcept = default;
+    /// Views `len` code units at ptr
+    constexpr U16StrView(const char16_t *ptr, size_t len) noexcept : ptr(ptr), len(len) {}
+    /// Views a character array up to its nul terminator
+    template <size_t N>
+    constexpr U16StrView(const char16_t (&s)[N]) noexcept : ptr(s), len(length(s)) {}
+    /// Views a nul-terminated string, computing its length once
+    explicit constexpr U16StrView(const char16_t *s) noexcept : ptr(s), len(length(s)) {}
+
+  private:
+    static constexpr size_t length(const char16_t *s) noexcept {
+        size_t n = 0;
+        while (s && s[n])
+            ++n;
+        return n;
+    }
+};
+
+/// Makes a StrView of a string literal, with its length taken from the literal
+#define EMLITE_STR(s) (emlite::StrView(s, sizeof(s) - 1))
+
+/// An interned property or method key.
+/// The key is converted to a javascript string once and its handle is kept
+/// alive for the lifetime of the program, so get/set/has/call using an Atom
+/// skip the string transcoding and the temporary key handle.
+/// Atoms should be created after `emlite::init()`, typically via EMLITE_ATOM.
+class Atom {
+    Handle h_;
+
+  public:
+    /// Interns a nul-terminated key
+    explicit Atom(const char *name) noexcept;
+    /// Interns a key of the specified length
+    Atom(const char *name, size_t len) noexcept;
+    /// Interns a key from a string view
+    explicit Atom(StrView name) noexcept : Atom(name.ptr, name.len) {}
+    /// @returns the persistent handle of the key
+    [[nodiscard]] Handle as_handle() const noexcept { return h_; }
+};
+
+/// Resolves a global once per call site and yields the cached
+/// `const emlite::Val &`, for lookups like `document` in hot paths
+#define EMLITE_GLOBAL(name)                                                                        \
+    ([]() -> const emlite::Val & {                                                                 \
+        static const emlite::Val global_ = emlite::Val::global(name);                              \
+        return global_;                                                                            \
+    }())
+
+/// Interns a string literal once per call site and yields the cached
+/// `const emlite::Atom &`
+#define EMLITE_ATOM(name)                                                                          \
+    ([]() -> const emlite::Atom & {                                                                \
+        static const emlite::Atom atom_(name, sizeof(name) - 1);                                   \
+        return atom_;                                                                              \
+    }())
 
 struct Params {
     Val *vals;
     size_t len;
 };
 
+/// A borrowed view of a javascript handle.
+/// ValRef is trivially copyable and never touches the refcount, so passing
+/// it around costs no crossings. It must not outlive the object it was taken from.
+class ValRef {
+    Handle h_;
+
+  public:
+    /// Borrows a raw handle
+    constexpr explicit ValRef(Handle h) noexcept : h_(h) {}
+    /// Borrows the handle of a Val
+    ValRef(const Val &v) noexcept;
+    /// @returns the borrowed handle
+    [[nodiscard]] Handle as_handle() const noexcept { return h_; }
+};
+
+/// Javascript globals which are resolved once by `emlite::init()`
+/// and kept alive for the lifetime of the program
+enum class Intrinsic : unsigned char {
+    Function,
+    Error,
+    Array,
+    Object,
+    Promise,
+    String,
+    Number,
+    Symbol,
+    Reflect,
+    JSON,
+    ArrayBuffer,
+    Int8Array,
+    Uint8Array,
+    Int16Array,
+    Uint16Array,
+    Int32Array,
+    Uint32Array,
+    Float32Array,
+    Float64Array,
+    BigInt64Array,
+    BigUint64Array,
+    Count,
+};
+
+/// The kind of a javascript value, as returned by `Val::kind()` in a single crossing.
+/// The values must match `emlite_val_kind` in scripts/index.js.
+enum class Kind : unsigned char {
+    Undefined,
+    Null,
+    Bool,
+    Number,
+    BigInt,
+    String,
+    Symbol,
+    Function,
+    Array,
+    TypedArray,
+    Error,
+    Object,
+};
+
+/// The arguments `Val::visit` passes for kinds without a C++ value type.
+/// The reference kinds borrow the visited Val.
+namespace js {
+struct Undefined {};
+struct Null {};
+struct Symbol {
+    const Val &val;
+};
+struct Function {
+    const Val &val;
+};
+struct Array {
+    const Val &val;
+};
+struct TypedArray {
+    const Val &val;
+};
+struct Error {
+    const Val &val;
+};
+struct Object {
+    const Val &val;
+};
+} // namespace js
+
+namespace detail {
+template <typename... Fs>
+struct Overloaded : Fs... {
+    using Fs::operator()...;
+};
+
+template <typename... Fs>
+Overloaded(Fs...) -> Overloaded<Fs...>;
+
+/// Maps an arithmetic element type to the TypedArray constructor
+/// which shares its memory layout
+template <typename T>
+constexpr Intrinsic typed_array_intrinsic() {
+    static_assert(
+        is_integral_v<T> || is_floating_point_v<T>, "TypedArray elements must be arithmetic"
+    );
+    if constexpr (is_floating_point_v<T>) {
+        static_assert(sizeof(T) == 4 || sizeof(T) == 8, "unsupported floating point size");
+        return sizeof(T) == 4 ? Intrinsic::Float32Array : Intrinsic::Float64Array;
+    } else if constexpr (sizeof(T) == 1) {
+        return is_signed_v<T> ? Intrinsic::Int8Array : Intrinsic::Uint8Array;
+    } else if constexpr (sizeof(T) == 2) {
+        return is_signed_v<T> ? Intrinsic::Int16Array : Intrinsic::Uint16Array;
+    } else if constexpr (sizeof(T) == 4) {
+        return is_signed_v<T> ? Intrinsic::Int32Array : Intrinsic::Uint32Array;
+    } else {
+        static_assert(sizeof(T) == 8, "unsupported integer size");
+        return is_signed_v<T> ? Intrinsic::BigInt64Array : Intrinsic::BigUint64Array;
+    }
+}
+
+/// The type of a field of an EMLITE_REFLECT struct, must match the shape
+/// compiler of scripts/index.js
+enum class FieldKind : uint32_t {
+    I8,
+    U8,
+    I16,
+    U16,
+    I32,
+    U32,
+    I64,
+    U64,
+    F32,
+    F64,
+    Bool,
+    CStr,
+    StrView,
+};
+
+/// A field of an EMLITE_REFLECT struct, read by javascript as three u32
+struct Field {
+    const char *name;
+    uint32_t offset;
+    FieldKind kind;
+};
+
+/// A column of Val::extract_columns, read by javascript as four u32
+struct Column {
+    const char *key;
+    uint32_t key_len;
+    FieldKind kind;
+    void *dst;
+};
+
+/// The field table of an EMLITE_REFLECT struct
+struct Shape {
+    const Field *fields;
+    uint32_t count;
+    uint32_t size;
+};
+
+template <typename F>
+constexpr FieldKind field_kind() {
+    if constexpr (is_same_v<F, bool>) {
+        return FieldKind::Bool;
+    } else if constexpr (is_floating_point_v<F>) {
+        static_assert(sizeof(F) == 4 || sizeof(F) == 8, "unsupported floating point size");
+        return sizeof(F) == 4 ? FieldKind::F32 : FieldKind::F64;
+    } else if constexpr (is_integral_v<F>) {
+        if constexpr (sizeof(F) == 1)
+            return is_signed_v<F> ? FieldKind::I8 : FieldKind::U8;
+        else if constexpr (sizeof(F) == 2)
+            return is_signed_v<F> ? FieldKind::I16 : FieldKind::U16;
+        else if constexpr (sizeof(F) == 4)
+            return is_signed_v<F> ? FieldKind::I32 : FieldKind::U32;
+        else
+            return is_signed_v<F> ? FieldKind::I64 : FieldKind::U64;
+    } else if constexpr (is_same_v<F, const char *>) {
+        return FieldKind::CStr;
+    } else {
+        static_assert(
+            is_same_v<F, emlite::StrView>,
+            "EMLITE_REFLECT fields must be numbers, bools, const char * or StrView"
+        );
+        return FieldKind::StrView;
+    }
+}
+
+template <typename T, typename = void>
+struct is_reflected : false_type {};
+
+// EMLITE_REFLECT declares emlite_reflect next to the struct, found by ADL
+template <typename T>
+struct is_reflected<T, void_t<decltype(emlite_reflect(static_cast<const T *>(nullptr)))>>
+    : true_type {};
+
+template <typename T>
+inline constexpr bool is_reflected_v = is_reflected<T>::value;
+
+/// @returns the field table of a reflected struct
+template <typename T>
+const Shape &fields_of() noexcept {
+    return emlite_reflect(static_cast<const T *>(nullptr));
+}
+
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+/// @returns the handle of the javascript shape of a reflected struct, which is
+/// compiled on first use and stays alive for the lifetime of the program
+template <typename T>
+Handle shape_of() noexcept {
+    static const Handle shape = [] {
+        const Shape &s = fields_of<T>();
+        return emlite_val_shape_define(s.fields, s.count, s.size);
+    }();
+    return shape;
+}
+#else
+// Without the runtime imports, reflected structs are transferred one field at
+// a time through the emcore imports, see src/emlite.cpp
+Handle make_fields(const Shape &s, const void *ptr) noexcept;
+void read_fields(const Shape &s, Handle obj, void *ptr) noexcept;
+Handle make_fields_array(const Shape &s, const void *ptr, size_t n) noexcept;
+size_t read_fields_array(const Shape &s, Handle arr, void *ptr, size_t cap) noexcept;
+#endif
+
+/// Creates an object from a reflected struct
+template <typename T>
+Handle shape_make(const T *ptr) noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    return emlite_val_shape_make(shape_of<T>(), ptr);
+#else
+    return make_fields(fields_of<T>(), ptr);
+#endif
+}
+
+/// Writes the fields of an object into a reflected struct
+template <typename T>
+void shape_read(Handle obj, T *ptr) noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    emlite_val_shape_read(shape_of<T>(), obj, ptr);
+#else
+    read_fields(fields_of<T>(), obj, ptr);
+#endif
+}
+
+/// Creates an Array of objects from `n` reflected structs
+template <typename T>
+Handle shape_make_array(const T *ptr, size_t n) noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    return emlite_val_shape_make_array(shape_of<T>(), ptr, n);
+#else
+    return make_fields_array(fields_of<T>(), ptr, n);
+#endif
+}
+
+/// Writes up to `cap` objects of an Array into reflected structs
+/// @returns the number of structs written
+template <typename T>
+size_t shape_read_array(Handle arr, T *ptr, size_t cap) noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    return emlite_val_shape_read_array(shape_of<T>(), arr, ptr, cap);
+#else
+    return read_fields_array(fields_of<T>(), arr, ptr, cap);
+#endif
+}
+} // namespace detail
+
 /// A high-level RAII wrapper around javascript Handle's
 class Val {
     Handle v_;
     Val() noexcept;
 
+    static Val *intrinsics_;
+    static void init_intrinsics() noexcept;
+    friend void init();
+    friend class ValRef;
+    friend class OwnedVal;
+
+    /// Converts a call argument into an owned temporary, unless it already
+    /// has a handle which can be borrowed, in which case an empty Val is returned
+    template <typename T>
+    static Val own_arg(T &&v) noexcept {
+        if constexpr (detail::has_as_handle_v<T>) {
+            return Val();
+        } else {
+            return Val(detail::forward<T>(v));
+        }
+    }
+    /// @returns the handle to pass for an argument, borrowed when possible
+    /// @param owned the temporary created by own_arg
+    template <typename T>
+    static Handle arg_handle(const Val &owned, const T &v) noexcept {
+        if constexpr (detail::has_as_handle_v<T>) {
+            return v.as_handle();
+        } else {
+            return owned.v_;
+        }
+    }
+#if !EMLITE_HAVE_RUNTIME_IMPORTS
+    /// Collects call arguments into a javascript array, for the emcore call imports
+    template <class... Args>
+    static Val args_array(Args &&...vals) noexcept {
+        auto arr = Val::take_ownership(detail::emlite_val_new_array());
+        Val keep_alive[sizeof...(Args) + 1] = {Val::own_arg(detail::forward<Args>(vals))...};
+        size_t i                            = 0;
+        (detail::emlite_val_push(arr.v_, Val::arg_handle(keep_alive[i++], vals)), ...);
+        return arr;
+    }
+#endif
+
   public:
     /// The copy constructor. This increments the refcount
     /// of the javascript object
@@ -107,6 +768,10 @@ class Val {
     static Val global(const char *name) noexcept;
     /// Gets the globalThis object.
     static Val global() noexcept;
+    /// Gets a pre-resolved javascript intrinsic without crossing into
+    /// javascript. Only valid after `emlite::init()`.
+    /// @param which the intrinsic
+    static const Val &intrinsic(Intrinsic which) noexcept;
     /// Returns a javascript null
     static Val null() noexcept;
     /// Returns a javascript undefined
@@ -115,15 +780,61 @@ class Val {
     static Val object() noexcept;
     /// Returns an empty javascript array
     static Val array() noexcept;
-    /// Creates a JavaScript Array from a span (pointer + length), pushing elements.
-    /// Each element is converted to a Val and appended using `Array.prototype.push`.
+    /// Creates a JavaScript Array from a span (pointer + length).
+    /// Arithmetic elements are copied in bulk through a TypedArray view,
+    /// EMLITE_REFLECT structs are all converted in a single crossing,
+    /// other elements are converted to a Val and appended using `Array.prototype.push`.
     template <typename T>
     static Val from_span(const T *ptr, size_t len) noexcept;
+    /// Creates a TypedArray which aliases wasm linear memory, without copying.
+    /// The element type (Float32Array, Int32Array, Uint8Array...) is picked from T.
+    /// The view is detached by javascript if the wasm memory grows, so it
+    /// shouldn't outlive the allocation nor be kept across allocations.
+    /// Without the runtime imports (wasip2 components, emscripten's default
+    /// mode), javascript has no access to linear memory and this is a copy.
+    /// @param ptr the first element
+    /// @param len the number of elements
+    template <typename T>
+    static Val view_of(const T *ptr, size_t len) noexcept;
+    /// Creates a TypedArray holding a copy of the span, made in a single bulk copy.
+    /// The element type is picked from T. Without the runtime imports, the
+    /// elements are set one crossing at a time.
+    /// @param ptr the first element
+    /// @param len the number of elements
+    template <typename T>
+    static Val typed_array(const T *ptr, size_t len) noexcept;
+    /// Reads properties of every element of a javascript array of objects into
+    /// columns, in a single pass on the javascript side, so that the rows cost
+    /// no crossing. Missing properties read as 0, or NaN for floating point
+    /// columns. Without the runtime imports, it takes one `get` per row and
+    /// column instead. Defined in emlite/buf.hpp.
+    ///
+    ///     Buf<double> xs, ys;
+    ///     Buf<int32_t> ids;
+    ///     auto rows = Val::extract_columns(points, {"x", "y", "id"}, xs, ys, ids);
+    ///
+    /// @param array an Array or array-like of objects
+    /// @param keys the property read into each column
+    /// @param cols the columns, resized to the number of rows
+    /// @returns the number of rows
+    template <typename... Ts, size_t... Ns>
+    static size_t extract_columns(
+        const Val &array, const char *const (&keys)[sizeof...(Ts)], Buf<Ts, Ns> &...cols
+    );
     /// Creates a javascript function
     /// @param f is function pointer of type Handle
     /// (*)(Handle)
     static Val make_fn(Callback f, Val data = Val::null()) noexcept;
+    /// Creates a javascript function from a closure.
+    /// The closure is freed by `dispose_fn`, or once javascript garbage
+    /// collects the function.
+    /// @param f the closure invoked with the function's arguments
     static Val make_fn(Closure<Val(Params)> &&f) noexcept;
+    /// Frees the closure of a function created by `make_fn(Closure)`.
+    /// Calling the function from javascript afterwards throws.
+    /// This is a no-op for other functions.
+    /// @param fn the function
+    static void dispose_fn(const Val &fn) noexcept;
     template <typename Ret, typename... Args, typename F>
     static Val make_fn(F &&f) noexcept {
         // Move/capture the callable to avoid const-qualification issues in the lambda body
@@ -144,7 +855,7 @@ class Val {
     static void delete_(Val &&v) noexcept;
     /// Throws a Val on the js side
     /// @param v the object thrown
-    static void throw_(const Val &v);
+    static void throw_(ValRef v);
     /// Creates a new Val from a Handle, while also
     /// incrementing its refcount
     /// @param h the Handle to duplicate
@@ -157,30 +868,34 @@ class Val {
     /// is_integral or is_floating_point or a string or has
     /// a `T::as_handle()` method
   private:
+    /// @returns whether the value is of kind k. Without the runtime imports,
+    /// a single is_* query for the kinds which have one rather than kind()
+    [[nodiscard]] bool has_kind(Kind k) const noexcept;
+
     /// Template helper to dispatch integer types to
     /// appropriate creation functions
     template <typename T>
     static Handle make_integer_value(T value) noexcept {
         if constexpr (detail::is_same_v<T, bool>) {
-            return emlite_val_make_bool(value ? 1 : 0);
+            return detail::emlite_val_make_bool(value ? 1 : 0);
         } else if constexpr (sizeof(T) <= 4 && detail::is_signed_v<T>) {
             // int8_t, int16_t, int32_t, short, int (if
             // 32-bit), signed char
-            return emlite_val_make_int(static_cast<int>(value));
+            return detail::emlite_val_make_int(static_cast<int>(value));
         } else if constexpr (sizeof(T) <= 4 && !detail::is_signed_v<T>) {
             // uint8_t, uint16_t, uint32_t, unsigned short,
             // unsigned int (if 32-bit), unsigned char
-            return emlite_val_make_uint(static_cast<unsigned int>(value));
+            return detail::emlite_val_make_uint(static_cast<unsigned int>(value));
         } else if constexpr (sizeof(T) == 8 && detail::is_signed_v<T>) {
             // int64_t, long long, long (if 64-bit)
-            return emlite_val_make_bigint(static_cast<long long>(value));
+            return detail::emlite_val_make_bigint(static_cast<long long>(value));
         } else if constexpr (sizeof(T) == 8 && !detail::is_signed_v<T>) {
             // uint64_t, unsigned long long, size_t (if
             // 64-bit)
-            return emlite_val_make_biguint(static_cast<unsigned long long>(value));
+            return detail::emlite_val_make_biguint(static_cast<unsigned long long>(value));
         } else {
             // Fallback for unusual integer types
-            return emlite_val_make_int(static_cast<int>(value));
+            return detail::emlite_val_make_int(static_cast<int>(value));
         }
     }
 
@@ -189,32 +904,35 @@ class Val {
     template <typename T>
     T get_integer_value(Handle h) const noexcept {
         if constexpr (detail::is_same_v<T, bool>) {
-            return !emlite_val_not(h);
+            return !detail::emlite_val_not(h);
         } else if constexpr (sizeof(T) <= 4 && detail::is_signed_v<T>) {
             // int8_t, int16_t, int32_t, short, int (if
             // 32-bit), signed char
-            return static_cast<T>(emlite_val_get_value_int(h));
+            return static_cast<T>(detail::emlite_val_get_value_int(h));
         } else if constexpr (sizeof(T) <= 4 && !detail::is_signed_v<T>) {
             // uint8_t, uint16_t, uint32_t, unsigned short,
             // unsigned int (if 32-bit), unsigned char
-            return static_cast<T>(emlite_val_get_value_uint(h));
+            return static_cast<T>(detail::emlite_val_get_value_uint(h));
         } else if constexpr (sizeof(T) == 8 && detail::is_signed_v<T>) {
             // int64_t, long long, long (if 64-bit)
-            return static_cast<T>(emlite_val_get_value_bigint(h));
+            return static_cast<T>(detail::emlite_val_get_value_bigint(h));
         } else if constexpr (sizeof(T) == 8 && !detail::is_signed_v<T>) {
             // uint64_t, unsigned long long, size_t (if
             // 64-bit)
-            return static_cast<T>(emlite_val_get_value_biguint(h));
+            return static_cast<T>(detail::emlite_val_get_value_biguint(h));
         } else {
             // Fallback for unusual integer types
-            return static_cast<T>(emlite_val_get_value_int(h));
+            return static_cast<T>(detail::emlite_val_get_value_int(h));
         }
     }
 
   public:
     /// Generic converting constructor.
     /// Notes:
-    /// - Accepts numeric types, C/UTF-16 strings, or types convertible to Val.
+    /// - Accepts numeric types, C/UTF-16 strings, StrView/U16StrView, or types
+    ///   convertible to Val. Views are passed with their length, without a scan.
+    /// - EMLITE_REFLECT structs become objects of a fixed shape, built by
+    ///   javascript from the struct's memory in a single crossing.
     /// - For non-primitive types, the branch expects `v.as_handle()`; if a type
     ///   does not model this interface (i.e., is not Val or a Val-like wrapper),
     ///   this intentionally triggers a hard compile error to catch misuse early
@@ -224,43 +942,52 @@ class Val {
         if constexpr (detail::is_integral_v<T>) {
             v_ = make_integer_value(v); // No overflow, preserves signedness
         } else if constexpr (detail::is_floating_point_v<T>) {
-            v_ = emlite_val_make_double(v);
+            v_ = detail::emlite_val_make_double(v);
         } else if constexpr (detail::is_same_v<T, const char *> || detail::is_same_v<T, char *>) {
-            v_ = emlite_val_make_str(v, strlen(v));
+            v_ = detail::make_str(v, strlen(v));
         } else if constexpr (detail::is_same_v<T, const char16_t *> || detail::is_same_v<T, char16_t *>) {
-            // Calculate length of char16_t string
-            size_t len = 0;
-            const char16_t *ptr = v;
-            while (ptr && *ptr != 0) { ++len; ++ptr; }
-            v_ = emlite_val_make_str_utf16((uint16_t *)v, len);
+            U16StrView s(v);
+            v_ = detail::emlite_val_make_str_utf16((uint16_t *)s.ptr, s.len);
+        } else if constexpr (detail::is_same_v<T, StrView>) {
+            v_ = detail::make_str(v.ptr, v.len);
+        } else if constexpr (detail::is_same_v<T, U16StrView>) {
+            v_ = detail::emlite_val_make_str_utf16((uint16_t *)v.ptr, v.len);
+        } else if constexpr (detail::is_reflected_v<T>) {
+            v_ = detail::shape_make(&v);
         } else {
-            emlite_val_inc_ref(v.as_handle());
             v_ = v.as_handle();
+            if (v_)
+                detail::handle_retain(v_);
+            return;
         }
+        detail::handle_adopt(v_);
     }
 
     /// @returns the raw javascript handle from this Val
     [[nodiscard]] Handle as_handle() const noexcept __attribute__((always_inline));
     /// Get the Val object's property
-    /// @param prop the property name
+    /// @param prop the property name, a StrView, or an Atom
     template <typename T>
     [[nodiscard]] Val get(T &&prop) const {
-        return Val::take_ownership(emlite_val_get(v_, Val(detail::forward<T>(prop)).as_handle()));
+        auto owned = Val::own_arg(detail::forward<T>(prop));
+        return Val::take_ownership(detail::emlite_val_get(v_, Val::arg_handle(owned, prop)));
     }
     /// Set the Val object's property
-    /// @param prop the property name
-    /// @param val the property's value
+    /// @param prop the property name, a StrView, or an Atom
+    /// @param val the property's value, string values can be passed
+    /// as a StrView or U16StrView to skip the length scan
     template <typename T, typename U>
     void set(T &&prop, U &&v) const {
-        emlite_val_set(
-            v_, Val(detail::forward<T>(prop)).as_handle(), Val(detail::forward<U>(v)).as_handle()
-        );
+        auto owned_prop = Val::own_arg(detail::forward<T>(prop));
+        auto owned_v    = Val::own_arg(detail::forward<U>(v));
+        detail::emlite_val_set(v_, Val::arg_handle(owned_prop, prop), Val::arg_handle(owned_v, v));
     }
     /// Checks whether a property exists
-    /// @param prop the property to check
+    /// @param prop the property to check, or an Atom
     template <typename T>
     bool has(T &&prop) const {
-        return emlite_val_has(v_, Val(detail::forward<T>(prop)).as_handle());
+        auto owned = Val::own_arg(detail::forward<T>(prop));
+        return detail::emlite_val_has(v_, Val::arg_handle(owned, prop));
     }
     /// Determine whether an object possesses a direct,
     /// own property with a specified name,
@@ -268,6 +995,8 @@ class Val {
     /// prototype chain
     /// @param prop the property name
     bool has_own_property(const char *prop) const noexcept;
+    /// @param prop the property name, with its length
+    bool has_own_property(StrView prop) const noexcept;
     /// @returns a string indicating the type of the
     /// javascript object
     [[nodiscard]] Uniq<char[]> type_of() const noexcept;
@@ -278,6 +1007,8 @@ class Val {
         return get(detail::forward<T>(idx));
     }
     /// Awaits the function object
+    /// @returns a promise resolving to the awaited value. It used to resolve
+    /// to a handle number of the value, whose handle was never released.
     [[nodiscard]] Val await() const;
     /// @returns bool if Val is a number
     [[nodiscard]] bool is_bool() const noexcept;
@@ -289,33 +1020,44 @@ class Val {
     [[nodiscard]] bool is_function() const noexcept;
     /// @returns bool if Val is an error
     [[nodiscard]] bool is_error() const noexcept;
+    /// @returns the kind of the value, in a single crossing. Without the runtime
+    /// imports it is found through the is_* and typeof queries, one at a time.
+    [[nodiscard]] Kind kind() const noexcept;
+    /// Calls the overload of `fs` matching the value's kind, after a single kind query.
+    /// The overloads receive js::Undefined, js::Null, bool, double (Number),
+    /// long long (BigInt), emlite::String, or one of js::Symbol, js::Function,
+    /// js::Array, js::TypedArray, js::Error and js::Object borrowing this Val.
+    /// Every kind must be handled, a generic `[](auto &&)` overload can serve as fallback.
+    /// @returns the result of the called overload
+    template <typename... Fs>
+    decltype(auto) visit(Fs &&...fs) const;
     /// @returns bool if Val is undefined
     [[nodiscard]] bool is_undefined() const noexcept;
     /// @returns bool if Val is null
     [[nodiscard]] bool is_null() const noexcept;
     /// @returns bool if Val is an instanceof
     /// @param v the other Val
-    [[nodiscard]] bool instanceof (const Val &v) const noexcept;
+    [[nodiscard]] bool instanceof (ValRef v) const noexcept;
     /// Not applied to Val
     bool operator!() const;
     /// @returns whether this Val strictly equals
     /// @param other the other Val
-    bool operator==(const Val &other) const;
+    bool operator==(ValRef other) const;
     /// @returns whether this Val doesn't equal
     /// @param other the other Val
-    bool operator!=(const Val &other) const;
+    bool operator!=(ValRef other) const;
     /// @returns whether this Val is greater than
     /// @param other the other Val
-    bool operator>(const Val &other) const;
+    bool operator>(ValRef other) const;
     /// @returns whether this Val is greater than or equals
     /// @param other the other Val
-    bool operator>=(const Val &other) const;
+    bool operator>=(ValRef other) const;
     /// @returns whether this Val is less than
     /// @param other the other Val
-    bool operator<(const Val &other) const;
+    bool operator<(ValRef other) const;
     /// @returns whether this Val is less than or equals
     /// @param other the other Val
-    bool operator<=(const Val &other) const;
+    bool operator<=(ValRef other) const;
 
     /// Calls the specified method of the Val object
     /// @param method the method name
@@ -327,6 +1069,22 @@ class Val {
     template <class... Args, typename detail::enable_if_t<detail::is_base_of_v<Val, Args>>...>
     Val call(const char *method, Args &&...vals) const noexcept;
 
+    /// Calls the specified method of the Val object
+    /// @param method the method name, with its length
+    /// @param vals the arguments to the method
+    /// @returns a Val object which also could be undefined
+    /// in js terms
+    template <class... Args, typename detail::enable_if_t<detail::is_base_of_v<Val, Args>>...>
+    Val call(StrView method, Args &&...vals) const noexcept;
+
+    /// Calls the method named by an interned Atom
+    /// @param method the method's Atom
+    /// @param vals the arguments to the method
+    /// @returns a Val object which also could be undefined
+    /// in js terms
+    template <class... Args, typename detail::enable_if_t<detail::is_base_of_v<Val, Args>>...>
+    Val call(const Atom &method, Args &&...vals) const noexcept;
+
     /// Calls the specified constructor of the Val object
     /// @tparam the arguments to the method should be of
     /// type Val or derived from it
@@ -347,48 +1105,199 @@ class Val {
     /// @tparam the type of the returned  object
     /// @returns the underlying value of the Val object if
     /// possible. requires that the underlying type is a
-    /// numeric or string, or a type which has a
+    /// numeric or string, an EMLITE_REFLECT struct (read in a single
+    /// crossing, string fields are left default), or a type which has a
     /// `take_ownership` static method which returns Val
     template <typename T>
     [[nodiscard]] T as() const noexcept;
 
     template <typename T>
     [[nodiscard]] Option<T> safe_cast() const noexcept {
-        if constexpr (detail::is_same_v<T, bool> && is_bool()) {
-            return as<bool>();
-        } else if constexpr (detail::is_integral_v<T> && is_number()) {
-            return get_integer_value<T>(v_);
-        } else if constexpr (detail::is_floating_point_v<T> && is_number()) {
-            return as<T>();
-        } else if constexpr (detail::is_same_v<T, Uniq<char[]>> && is_string()) {
-            return as<T>();
-        } else if constexpr (detail::is_same_v<T, Uniq<char16_t[]>> && is_string()) {
-            return as<T>();
-        } else if (T::instance() == emlite::Val("Any")) {
-            return as<T>();
-        } else if (instanceof (T::instance()) && detail::is_base_of_v<Val, T>) {
-            return as<T>();
+        if constexpr (detail::is_same_v<T, bool>) {
+            if (has_kind(Kind::Bool))
+                return as<bool>();
+        } else if constexpr (detail::is_integral_v<T>) {
+            if (has_kind(Kind::Number))
+                return get_integer_value<T>(v_);
+        } else if constexpr (detail::is_floating_point_v<T>) {
+            if (has_kind(Kind::Number))
+                return as<T>();
+        } else if constexpr (detail::is_same_v<T, Uniq<char[]>> ||
+                             detail::is_same_v<T, Uniq<char16_t[]>>) {
+            if (has_kind(Kind::String))
+                return as<T>();
         } else {
-            return nullopt;
+            if (T::instance() == emlite::Val("Any"))
+                return as<T>();
+            if (instanceof (T::instance()) && detail::is_base_of_v<Val, T>)
+                return as<T>();
         }
+        return nullopt;
     }
 
-    /// Converts a javascript array to a Uniq C++ array
+    /// Copies the elements of a javascript Array or TypedArray of numbers
+    /// into a C++ buffer in a single crossing. TypedArrays are copied using
+    /// `TypedArray.prototype.set`, plain arrays using a loop on the js side.
+    /// Without the runtime imports, the elements are read one crossing at a time.
     /// @tparam any numeric type
+    /// @param dst the destination buffer
+    /// @param cap the capacity of dst in elements
+    /// @returns the number of elements copied, at most cap
+    template <typename T>
+    size_t copy_to(T *dst, size_t cap) const noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+        constexpr auto ctor = detail::typed_array_intrinsic<T>();
+        return detail::emlite_val_copy_to(v_, Val::intrinsic(ctor).as_handle(), dst, cap);
+#else
+        auto n = get(EMLITE_ATOM("length")).template as<size_t>();
+        if (n > cap)
+            n = cap;
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = get(static_cast<uint32_t>(i)).template as<T>();
+        return n;
+#endif
+    }
+
+    /// Converts a javascript array to a Uniq C++ array.
+    /// For numbers, `Buf<T>::from_js` keeps the length with the array.
+    /// @tparam any numeric type, an EMLITE_REFLECT struct, or a Val
     /// @param v The Val representing the javascript array
     /// @param[in,out] len the length of the C++ array that
     /// was returned
     /// @returns a Uniq C++ array
     template <typename T>
     static Uniq<T[]> vec_from_js_array(const Val &v, size_t &len) {
-        auto sz = v.get("length").as<int>();
-        len     = sz;
-        T *ret  = new T[sz];
-        for (int i = 0; i < sz; i++) {
-            ret[i] = v[i].as<T>();
+        auto sz = v.get(EMLITE_ATOM("length")).template as<size_t>();
+        T *ret  = new T[sz]();
+        if constexpr (detail::is_integral_v<T> || detail::is_floating_point_v<T>) {
+            len = v.copy_to(ret, sz);
+        } else if constexpr (detail::is_reflected_v<T>) {
+            len = detail::shape_read_array(v.v_, ret, sz);
+        } else {
+            len = sz;
+            for (size_t i = 0; i < sz; i++) {
+                ret[i] = v[i].as<T>();
+            }
         }
         return Uniq<T[]>(ret);
     }
+
+    /// Converts a javascript array of numbers to a C++ array allocated from an arena
+    /// @tparam any numeric type
+    /// @param v The Val representing the javascript array
+    /// @param[in,out] len the length of the C++ array that
+    /// was returned
+    /// @param arena the arena to allocate from, e.g. `FrameScope::arena()`
+    /// @returns the array, valid until the arena is rewound
+    template <typename T>
+    static ArenaUniq<T[]> vec_from_js_array(const Val &v, size_t &len, Arena &arena) {
+        static_assert(
+            detail::is_integral_v<T> || detail::is_floating_point_v<T>,
+            "arena arrays hold numbers, Vals need destruction"
+        );
+        auto sz = v.get(EMLITE_ATOM("length")).template as<size_t>();
+        T *ret  = arena.allocate_array<T>(sz);
+        if (!ret) {
+            len = 0;
+            return ArenaUniq<T[]>();
+        }
+        len = v.copy_to(ret, sz);
+        return ArenaUniq<T[]>(ret, false);
+    }
+};
+
+inline ValRef::ValRef(const Val &v) noexcept : h_(v.v_) {}
+
+/// An owning handle without a vtable, the size of a Handle, for storing
+/// javascript objects in containers. Copies increment the refcount, moves don't.
+class OwnedVal {
+    Handle h_ = 0;
+
+  public:
+    OwnedVal() noexcept = default;
+    /// Takes over the handle of a Val
+    explicit OwnedVal(Val v) noexcept : h_(v.v_) { v.v_ = 0; }
+    OwnedVal(const OwnedVal &other) noexcept : h_(other.h_) {
+        if (h_)
+            detail::handle_retain(h_);
+    }
+    OwnedVal &operator=(const OwnedVal &other) noexcept {
+        if (this != &other) {
+            reset();
+            h_ = other.h_;
+            if (h_)
+                detail::handle_retain(h_);
+        }
+        return *this;
+    }
+    OwnedVal(OwnedVal &&other) noexcept : h_(other.h_) { other.h_ = 0; }
+    OwnedVal &operator=(OwnedVal &&other) noexcept {
+        if (this != &other) {
+            reset();
+            h_       = other.h_;
+            other.h_ = 0;
+        }
+        return *this;
+    }
+    ~OwnedVal() { reset(); }
+
+    /// Drops the owned handle
+    void reset() noexcept {
+        if (h_)
+            detail::handle_release(h_);
+        h_ = 0;
+    }
+    /// @returns a Val sharing the handle, incrementing its refcount
+    [[nodiscard]] Val to_val() const noexcept { return Val::dup(h_); }
+    /// @returns a borrowed view of the handle
+    [[nodiscard]] ValRef ref() const noexcept { return ValRef(h_); }
+    operator ValRef() const noexcept { return ValRef(h_); }
+    [[nodiscard]] Handle as_handle() const noexcept { return h_; }
+    [[nodiscard]] explicit operator bool() const noexcept { return h_ != 0; }
+};
+
+/// A UTF-8 string read from javascript, with small-string optimization.
+/// Strings of up to `inline_size` bytes are copied inline in a single crossing,
+/// without allocating. Longer strings keep the javascript string alive and are
+/// only transcoded into linear memory when their bytes are first accessed;
+/// size, comparisons and prefix checks don't need the copy. Without the runtime
+/// imports, strings are copied whole on construction.
+/// Obtained with `val.as<String>()`, other values are converted with `String(v)`.
+class String {
+  public:
+    static constexpr size_t inline_size = 22;
+
+  private:
+    OwnedVal str_;
+    size_t len_         = 0;
+    mutable char *heap_ = nullptr;
+    char inline_[inline_size + 1] = {};
+
+    [[nodiscard]] bool is_inline() const noexcept { return len_ <= inline_size; }
+
+  public:
+    String() noexcept = default;
+    /// Reads a javascript value as a string
+    explicit String(const Val &v) noexcept;
+    String(const String &)            = delete;
+    String &operator=(const String &) = delete;
+    String(String &&other) noexcept;
+    String &operator=(String &&other) noexcept;
+    ~String();
+
+    /// @returns the length in UTF-8 bytes
+    [[nodiscard]] size_t size() const noexcept { return len_; }
+    [[nodiscard]] bool empty() const noexcept { return len_ == 0; }
+    /// @returns the nul-terminated bytes, transcoding long strings on first access
+    [[nodiscard]] const char *c_str() const noexcept;
+    [[nodiscard]] const char *data() const noexcept { return c_str(); }
+    [[nodiscard]] StrView view() const noexcept { return StrView(c_str(), len_); }
+    /// Compares by code point, like comparing the UTF-8 bytes
+    /// @returns a negative value, 0 or a positive value
+    [[nodiscard]] int compare(StrView other) const noexcept;
+    [[nodiscard]] bool starts_with(StrView prefix) const noexcept;
+    bool operator==(StrView other) const noexcept;
+    bool operator!=(StrView other) const noexcept { return !(*this == other); }
 };
 
 /// A wrapper around a console js object
@@ -418,137 +1327,252 @@ class Console : public Val {
     void clear() const;
 };
 
+// The argument arrays have a spare element, so that calls without arguments
+// don't declare zero-size arrays
 template <class... Args, typename detail::enable_if_t<detail::is_base_of_v<Val, Args>>...>
 Val Val::call(const char *method, Args &&...vals) const noexcept {
-    auto arr                        = Val::take_ownership(emlite_val_new_array());
-    Val keep_alive[sizeof...(Args)] = {Val(detail::forward<Args>(vals))...};
-    for (auto &v : keep_alive)
-        emlite_val_push(arr.as_handle(), v.as_handle());
-    return Val::take_ownership(emlite_val_obj_call(v_, method, strlen(method), arr.as_handle()));
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    Val keep_alive[sizeof...(Args) + 1] = {Val::own_arg(detail::forward<Args>(vals))...};
+    size_t i                            = 0;
+    Handle argv[sizeof...(Args) + 1]    = {Val::arg_handle(keep_alive[i++], vals)...};
+    return Val::take_ownership(
+        detail::emlite_val_obj_call_argv(v_, method, strlen(method), argv, sizeof...(Args))
+    );
+#else
+    auto arr = Val::args_array(detail::forward<Args>(vals)...);
+    return Val::take_ownership(detail::emlite_val_obj_call(v_, method, strlen(method), arr.v_));
+#endif
+}
+
+template <class... Args, typename detail::enable_if_t<detail::is_base_of_v<Val, Args>>...>
+Val Val::call(StrView method, Args &&...vals) const noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    Val keep_alive[sizeof...(Args) + 1] = {Val::own_arg(detail::forward<Args>(vals))...};
+    size_t i                            = 0;
+    Handle argv[sizeof...(Args) + 1]    = {Val::arg_handle(keep_alive[i++], vals)...};
+    return Val::take_ownership(
+        detail::emlite_val_obj_call_argv(v_, method.ptr, method.len, argv, sizeof...(Args))
+    );
+#else
+    auto arr = Val::args_array(detail::forward<Args>(vals)...);
+    return Val::take_ownership(detail::emlite_val_obj_call(v_, method.ptr, method.len, arr.v_));
+#endif
+}
+
+template <class... Args, typename detail::enable_if_t<detail::is_base_of_v<Val, Args>>...>
+Val Val::call(const Atom &method, Args &&...vals) const noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    Val keep_alive[sizeof...(Args) + 1] = {Val::own_arg(detail::forward<Args>(vals))...};
+    size_t i                            = 0;
+    Handle argv[sizeof...(Args) + 1]    = {Val::arg_handle(keep_alive[i++], vals)...};
+    return Val::take_ownership(
+        detail::emlite_val_obj_call_key_argv(v_, method.as_handle(), argv, sizeof...(Args))
+    );
+#else
+    // The emcore call imports take the method by name, so the method is
+    // looked up by key and invoked as `fn.call(this, ...vals)`
+    auto fn  = Val::take_ownership(detail::emlite_val_get(v_, method.as_handle()));
+    auto arr = Val::args_array(ValRef(v_), detail::forward<Args>(vals)...);
+    return Val::take_ownership(detail::emlite_val_obj_call(fn.v_, "call", 4, arr.v_));
+#endif
 }
 
 template <class... Args, typename detail::enable_if_t<detail::is_base_of_v<Val, Args>>...>
 Val Val::new_(Args &&...vals) const {
-    auto arr                        = Val::take_ownership(emlite_val_new_array());
-    Val keep_alive[sizeof...(Args)] = {Val(detail::forward<Args>(vals))...};
-    for (auto &v : keep_alive)
-        emlite_val_push(arr.as_handle(), v.as_handle());
-    return Val::take_ownership(emlite_val_construct_new(v_, arr.as_handle()));
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    Val keep_alive[sizeof...(Args) + 1] = {Val::own_arg(detail::forward<Args>(vals))...};
+    size_t i                            = 0;
+    Handle argv[sizeof...(Args) + 1]    = {Val::arg_handle(keep_alive[i++], vals)...};
+    return Val::take_ownership(detail::emlite_val_construct_new_argv(v_, argv, sizeof...(Args)));
+#else
+    auto arr = Val::args_array(detail::forward<Args>(vals)...);
+    return Val::take_ownership(detail::emlite_val_construct_new(v_, arr.v_));
+#endif
 }
 
 template <class... Args, typename detail::enable_if_t<detail::is_base_of_v<Val, Args>>...>
 Val Val::operator()(Args &&...vals) const {
-    auto arr                        = Val::take_ownership(emlite_val_new_array());
-    Val keep_alive[sizeof...(Args)] = {Val(detail::forward<Args>(vals))...};
-    for (auto &v : keep_alive)
-        emlite_val_push(arr.as_handle(), v.as_handle());
-    return Val::take_ownership(emlite_val_func_call(v_, arr.as_handle()));
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    Val keep_alive[sizeof...(Args) + 1] = {Val::own_arg(detail::forward<Args>(vals))...};
+    size_t i                            = 0;
+    Handle argv[sizeof...(Args) + 1]    = {Val::arg_handle(keep_alive[i++], vals)...};
+    return Val::take_ownership(detail::emlite_val_func_call_argv(v_, argv, sizeof...(Args)));
+#else
+    auto arr = Val::args_array(detail::forward<Args>(vals)...);
+    return Val::take_ownership(detail::emlite_val_func_call(v_, arr.v_));
+#endif
 }
 
 template <typename T>
 Val Val::from_span(const T *ptr, size_t len) noexcept {
-    auto arr = Val::array();
-    for (size_t i = 0; i < len; ++i) {
-        // Use method call so JS receives actual values, avoiding handle-lifetime issues
-        arr.call("push", Val(ptr[i]));
+    if constexpr (detail::is_integral_v<T> || detail::is_floating_point_v<T>) {
+        return Val::intrinsic(Intrinsic::Array).call(EMLITE_ATOM("from"), Val::view_of(ptr, len));
+    } else if constexpr (detail::is_reflected_v<T>) {
+        return Val::take_ownership(detail::shape_make_array(ptr, len));
+    } else {
+        auto arr = Val::array();
+        for (size_t i = 0; i < len; ++i) {
+            // Use method call so JS receives actual values, avoiding handle-lifetime issues
+            arr.call(EMLITE_ATOM("push"), Val(ptr[i]));
+        }
+        return arr;
     }
+}
+
+template <typename T>
+Val Val::view_of(const T *ptr, size_t len) noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    constexpr auto ctor = detail::typed_array_intrinsic<T>();
+    return Val::take_ownership(
+        detail::emlite_val_typed_array_view(Val::intrinsic(ctor).as_handle(), ptr, len)
+    );
+#else
+    // Linear memory isn't reachable from javascript through the emcore imports
+    return Val::typed_array(ptr, len);
+#endif
+}
+
+template <typename T>
+Val Val::typed_array(const T *ptr, size_t len) noexcept {
+    constexpr auto ctor = detail::typed_array_intrinsic<T>();
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    return Val::take_ownership(
+        detail::emlite_val_typed_array_copy(Val::intrinsic(ctor).as_handle(), ptr, len)
+    );
+#else
+    auto arr = Val::intrinsic(ctor).new_(Val(static_cast<uint32_t>(len)));
+    for (size_t i = 0; i < len; ++i)
+        arr.set(static_cast<uint32_t>(i), ptr[i]);
     return arr;
+#endif
+}
+
+template <typename... Fs>
+decltype(auto) Val::visit(Fs &&...fs) const {
+    detail::Overloaded<detail::remove_cvref_t<Fs>...> f{detail::forward<Fs>(fs)...};
+    using R = decltype(f(js::Undefined{}));
+    switch (kind()) {
+    case Kind::Undefined:
+        return static_cast<R>(f(js::Undefined{}));
+    case Kind::Null:
+        return static_cast<R>(f(js::Null{}));
+    case Kind::Bool:
+        return static_cast<R>(f(!detail::emlite_val_not(v_)));
+    case Kind::Number:
+        return static_cast<R>(f(detail::emlite_val_get_value_double(v_)));
+    case Kind::BigInt:
+        return static_cast<R>(f(static_cast<long long>(detail::emlite_val_get_value_bigint(v_))));
+    case Kind::String:
+        return static_cast<R>(f(String(*this)));
+    case Kind::Symbol:
+        return static_cast<R>(f(js::Symbol{*this}));
+    case Kind::Function:
+        return static_cast<R>(f(js::Function{*this}));
+    case Kind::Array:
+        return static_cast<R>(f(js::Array{*this}));
+    case Kind::TypedArray:
+        return static_cast<R>(f(js::TypedArray{*this}));
+    case Kind::Error:
+        return static_cast<R>(f(js::Error{*this}));
+    default:
+        return static_cast<R>(f(js::Object{*this}));
+    }
 }
 
 template <typename T>
 T Val::as() const noexcept {
+    // Every checked conversion costs one kind query at most, plus the read itself.
+    // Null and undefined are checked without crossing.
     if constexpr (detail::is_option_v<T>) {
         // Option<U> - return Some(value) or None
         using U = typename T::value_type;
-        // Simple type checking - return None for type
-        // mismatches
         if constexpr (detail::is_integral_v<U>) {
-            if (is_number()) {
+            if (has_kind(Kind::Number)) {
                 return T(get_integer_value<U>(v_));
             }
             return T(); // None
         } else if constexpr (detail::is_floating_point_v<U>) {
-            if (is_number()) {
-                return T(emlite_val_get_value_double(v_));
+            if (has_kind(Kind::Number)) {
+                return T(detail::emlite_val_get_value_double(v_));
             }
             return T(); // None
         } else if constexpr (detail::is_same_v<U, Uniq<char[]>>) {
-            if (is_string()) {
-                auto str_ptr = emlite_val_get_value_string(v_);
+            if (has_kind(Kind::String)) {
+                auto str_ptr = detail::emlite_val_get_value_string(v_);
                 if (str_ptr) {
                     return T(Uniq<char[]>(str_ptr));
                 }
             }
             return T(); // None
         } else if constexpr (detail::is_same_v<U, Uniq<char16_t[]>>) {
-            if (is_string()) {
-                auto str_ptr = (char16_t *)emlite_val_get_value_string_utf16(v_);
+            if (has_kind(Kind::String)) {
+                auto str_ptr = (char16_t *)detail::emlite_val_get_value_string_utf16(v_);
                 if (str_ptr) {
                     return T(Uniq<char16_t[]>(str_ptr));
                 }
             }
             return T(); // None
         } else {
-            if (this->is_error() || this->is_null() || this->is_undefined()) {
+            if (is_null() || is_undefined() || has_kind(Kind::Error)) {
                 return T();
-            } else 
-            return T(U(*this));
+            }
+            return T(this->template as<U>());
         }
     } else if constexpr (detail::is_result_v<T>) {
         // Result<U, E> - return Ok(value) or Err(error)
         using U = typename T::value_type;
         using E = typename T::error_type;
         if constexpr (detail::is_integral_v<U>) {
-            if (is_number()) {
+            if (has_kind(Kind::Number)) {
                 return ok<U, E>(get_integer_value<U>(v_));
             } else {
                 if constexpr (detail::is_same_v<E, Val>) {
-                    return err<U, E>(Val::global("Error").new_("Expected number"));
+                    return err<U, E>(Val::intrinsic(Intrinsic::Error).new_("Expected number"));
                 } else {
                     return err<U, E>(*this);
                 }
             }
         } else if constexpr (detail::is_floating_point_v<U>) {
-            if (is_number()) {
-                return ok<U, E>(emlite_val_get_value_double(v_));
+            if (has_kind(Kind::Number)) {
+                return ok<U, E>(detail::emlite_val_get_value_double(v_));
             } else {
                 if constexpr (detail::is_same_v<E, Val>) {
-                    return err<U, E>(Val::global("Error").new_("Expected number"));
+                    return err<U, E>(Val::intrinsic(Intrinsic::Error).new_("Expected number"));
                 } else {
                     return err<U, E>(*this);
                 }
             }
         } else if constexpr (detail::is_same_v<U, Uniq<char[]>>) {
-            if (is_string()) {
-                auto str_ptr = emlite_val_get_value_string(v_);
+            if (has_kind(Kind::String)) {
+                auto str_ptr = detail::emlite_val_get_value_string(v_);
                 if (str_ptr) {
                     return ok<U, E>(Uniq<char[]>(str_ptr));
                 }
             } else {
                 if constexpr (detail::is_same_v<E, Val>) {
-                    return T(Val::global("Error").new_("Expected string"));
+                    return T(Val::intrinsic(Intrinsic::Error).new_("Expected string"));
                 } else {
                     return T(*this);
                 }
             }
         } else if constexpr (detail::is_same_v<U, Uniq<char16_t[]>>) {
-            if (is_string()) {
-                auto str_ptr = (char16_t *)emlite_val_get_value_string_utf16(v_);
+            if (has_kind(Kind::String)) {
+                auto str_ptr = (char16_t *)detail::emlite_val_get_value_string_utf16(v_);
                 if (str_ptr) {
                     return ok<U, E>(Uniq<char16_t[]>(str_ptr));
                 }
             } else {
                 if constexpr (detail::is_same_v<E, Val>) {
-                    return T(Val::global("Error").new_("Expected string"));
+                    return T(Val::intrinsic(Intrinsic::Error).new_("Expected string"));
                 } else {
                     return T(*this);
                 }
             }
         } else {
-            if (is_error()) {
+            if (is_null() || is_undefined()) {
+                return err<U, E>(Val::intrinsic(Intrinsic::Error).new_("Found invalid value"));
+            } else if (has_kind(Kind::Error)) {
                 return err<U, E>(this->as<E>());
-            } else if (is_null() || is_undefined()) {
-                return err<U, E>(Val::global("Error").new_("Found invalid value"));
             } else {
                 return ok<U, E>(this->as<U>());
             }
@@ -556,12 +1580,18 @@ T Val::as() const noexcept {
     } else if constexpr (detail::is_integral_v<T>) {
         return get_integer_value<T>(v_); // Use type-specific getters
     } else if constexpr (detail::is_floating_point_v<T>)
-        return emlite_val_get_value_double(v_);
+        return detail::emlite_val_get_value_double(v_);
     else if constexpr (detail::is_same_v<T, Uniq<char[]>>)
-        return Uniq<char[]>(emlite_val_get_value_string(v_));
+        return Uniq<char[]>(detail::emlite_val_get_value_string(v_));
     else if constexpr (detail::is_same_v<T, Uniq<char16_t[]>>)
-        return Uniq<char16_t[]>((char16_t *)emlite_val_get_value_string_utf16(v_));
-    else {
+        return Uniq<char16_t[]>((char16_t *)detail::emlite_val_get_value_string_utf16(v_));
+    else if constexpr (detail::is_same_v<T, ArenaUniq<char[]>>)
+        return detail::arena_str(v_);
+    else if constexpr (detail::is_reflected_v<T>) {
+        T out{};
+        detail::shape_read(v_, &out);
+        return out;
+    } else {
         return T(*this);
     }
 }
@@ -572,28 +1602,44 @@ void Console::log(Args &&...args) const {
 }
 
 /// A helper function to run javascript eval using a string
-/// literal and printf style arguments
+/// literal and printf style arguments.
+/// This formats, parses and compiles the source on every call,
+/// EMLITE_EVAL compiles its snippet once instead.
+/// Within a FrameScope, the source is formatted in its arena.
 template <typename... Args>
 Val emlite_eval_cpp(const char *fmt, Args &&...args) {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wformat-security"
-    auto len  = snprintf(NULL, 0, fmt, detail::forward<Args>(args)...);
-    auto *ptr = (char *)malloc(len + 1);
+    auto len   = snprintf(NULL, 0, fmt, detail::forward<Args>(args)...);
+    auto arena = Arena::current();
+    auto *ptr  = arena ? arena->allocate_array<char>(len + 1) : (char *)malloc(len + 1);
     if (!ptr) {
         return Val::null();
     }
     (void)snprintf(ptr, len + 1, fmt, detail::forward<Args>(args)...);
 #pragma clang diagnostic pop
-    auto ret = Val::global("eval")(Val(ptr));
-    free(ptr);
+    auto ret = Val::global("eval")(Val(StrView(ptr, len)));
+    if (!arena)
+        free(ptr);
     return ret;
 }
 
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+/// Compiles a javascript snippet into a function.
+/// The printf-style placeholders of the snippet (%d, %s, %f...) become the
+/// parameters of the function, in order, and the value of a trailing expression
+/// statement is returned, like eval would. Placeholders inside string, template
+/// and regex literals are formatted into the literal like snprintf would.
+inline Val compile_eval(const char *src, size_t len) noexcept {
+    return Val::take_ownership(detail::emlite_val_compile_eval(src, len));
+}
+#endif
+
 // Option method implementations
 template <typename T>
 const T &Option<T>::value() const {
     if (!has_value_) {
-        Val::throw_(Val::global("Error").new_("Option has no value"));
+        Val::throw_(Val::intrinsic(Intrinsic::Error).new_("Option has no value"));
     }
     return value_;
 }
@@ -601,7 +1647,7 @@ const T &Option<T>::value() const {
 template <typename T>
 T &Option<T>::value() {
     if (!has_value_) {
-        Val::throw_(Val::global("Error").new_("Option has no value"));
+        Val::throw_(Val::intrinsic(Intrinsic::Error).new_("Option has no value"));
     }
     return value_;
 }
@@ -609,7 +1655,7 @@ T &Option<T>::value() {
 template <typename T>
 T Option<T>::expect(const char *message) const {
     if (!has_value_) {
-        Val::throw_(Val::global("Error").new_(message));
+        Val::throw_(Val::intrinsic(Intrinsic::Error).new_(message));
     }
     return value_;
 }
@@ -621,7 +1667,7 @@ const T &Result<T, E>::value() const {
         if (has_error_) {
             Val::throw_(error_);
         }
-        Val::throw_(Val::global("Error").new_("Result has no value"));
+        Val::throw_(Val::intrinsic(Intrinsic::Error).new_("Result has no value"));
     }
     return value_;
 }
@@ -632,7 +1678,7 @@ T &Result<T, E>::value() {
         if (has_error_) {
             Val::throw_(error_);
         }
-        Val::throw_(Val::global("Error").new_("Result has no value"));
+        Val::throw_(Val::intrinsic(Intrinsic::Error).new_("Result has no value"));
     }
     return value_;
 }
@@ -640,11 +1686,103 @@ T &Result<T, E>::value() {
 template <typename T, typename E>
 const E &Result<T, E>::error() const {
     if (!has_error_) {
-        Val::throw_(Val::global("Error").new_("Result has no error"));
+        Val::throw_(Val::intrinsic(Intrinsic::Error).new_("Result has no error"));
     }
     return error_;
 }
 
 } // namespace emlite
 
+/// Evaluates a javascript snippet with printf-style placeholders.
+/// The snippet is compiled once per call site into a cached function, and the
+/// arguments are passed as its parameters rather than formatted into the source:
+/// numbers stay numbers (so `EMLITE_VALMAP.toValue(%d)` with a handle still works),
+/// strings are passed as strings, and Vals as the values they hold.
+/// Without the runtime imports it formats and evaluates the snippet on every
+/// call with emlite_eval_cpp, which only takes printf arguments.
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+#define EMLITE_EVAL(x, ...)                                                                        \
+    ([]() -> const emlite::Val & {                                                                 \
+        static const emlite::Val fn_ = emlite::compile_eval(#x, sizeof(#x) - 1);                   \
+        return fn_;                                                                                \
+    }())(__VA_ARGS__)
+#else
 #define EMLITE_EVAL(x, ...) emlite::emlite_eval_cpp(#x __VA_OPT__(, __VA_ARGS__))
+#endif
+
+/// Describes the fields of a struct, so that `Val(s)`, `val.as<T>()`,
+/// `Val::from_span` and `Val::vec_from_js_array` transfer it through linear
+/// memory in a single crossing. Javascript compiles a reader and a writer for
+/// the struct once, and the objects it creates all have the same shape.
+/// Fields are numbers, bools (as booleans), 64-bit integers (as BigInts),
+/// and const char * or StrView, which are only converted to javascript.
+/// Without the runtime imports, structs are transferred one field at a time.
+/// Use it at namespace scope, next to the struct, with at most 32 fields:
+///
+///     struct Sample { double t; float value; uint32_t id; bool ok; };
+///     EMLITE_REFLECT(Sample, t, value, id, ok)
+#define EMLITE_REFLECT(Type, ...)                                                                  \
+    [[maybe_unused]] inline const ::emlite::detail::Shape &emlite_reflect(const Type *) noexcept { \
+        static constexpr ::emlite::detail::Field fields_[] = {                                     \
+            EMLITE_REFLECT_FOR_EACH(EMLITE_REFLECT_FIELD, Type, __VA_ARGS__)                       \
+        };                                                                                         \
+        static constexpr ::emlite::detail::Shape shape_ = {                                        \
+            fields_, sizeof(fields_) / sizeof(fields_[0]), sizeof(Type)                            \
+        };                                                                                         \
+        return shape_;                                                                             \
+    }
+
+#define EMLITE_REFLECT_FIELD(Type, f)                                                              \
+    ::emlite::detail::Field{                                                                       \
+        #f, __builtin_offsetof(Type, f), ::emlite::detail::field_kind<decltype(Type::f)>()         \
+    },
+
+// Applies M(Type, field) to each field
+#define EMLITE_REFLECT_FOR_EACH(M, T, ...)                                                         \
+    EMLITE_REFLECT_PICK(__VA_ARGS__,                                                               \
+        EMLITE_REFLECT_32, EMLITE_REFLECT_31, EMLITE_REFLECT_30, EMLITE_REFLECT_29,                \
+        EMLITE_REFLECT_28, EMLITE_REFLECT_27, EMLITE_REFLECT_26, EMLITE_REFLECT_25,                \
+        EMLITE_REFLECT_24, EMLITE_REFLECT_23, EMLITE_REFLECT_22, EMLITE_REFLECT_21,                \
+        EMLITE_REFLECT_20, EMLITE_REFLECT_19, EMLITE_REFLECT_18, EMLITE_REFLECT_17,                \
+        EMLITE_REFLECT_16, EMLITE_REFLECT_15, EMLITE_REFLECT_14, EMLITE_REFLECT_13,                \
+        EMLITE_REFLECT_12, EMLITE_REFLECT_11, EMLITE_REFLECT_10, EMLITE_REFLECT_9,                 \
+        EMLITE_REFLECT_8, EMLITE_REFLECT_7, EMLITE_REFLECT_6, EMLITE_REFLECT_5,                    \
+        EMLITE_REFLECT_4, EMLITE_REFLECT_3, EMLITE_REFLECT_2, EMLITE_REFLECT_1                     \
+    )(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_PICK(                                                                       \
+    _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20,     \
+    _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, N, ...                             \
+    )                                                                                              \
+    N
+#define EMLITE_REFLECT_1(M, T, a) M(T, a)
+#define EMLITE_REFLECT_2(M, T, a, ...) M(T, a) EMLITE_REFLECT_1(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_3(M, T, a, ...) M(T, a) EMLITE_REFLECT_2(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_4(M, T, a, ...) M(T, a) EMLITE_REFLECT_3(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_5(M, T, a, ...) M(T, a) EMLITE_REFLECT_4(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_6(M, T, a, ...) M(T, a) EMLITE_REFLECT_5(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_7(M, T, a, ...) M(T, a) EMLITE_REFLECT_6(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_8(M, T, a, ...) M(T, a) EMLITE_REFLECT_7(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_9(M, T, a, ...) M(T, a) EMLITE_REFLECT_8(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_10(M, T, a, ...) M(T, a) EMLITE_REFLECT_9(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_11(M, T, a, ...) M(T, a) EMLITE_REFLECT_10(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_12(M, T, a, ...) M(T, a) EMLITE_REFLECT_11(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_13(M, T, a, ...) M(T, a) EMLITE_REFLECT_12(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_14(M, T, a, ...) M(T, a) EMLITE_REFLECT_13(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_15(M, T, a, ...) M(T, a) EMLITE_REFLECT_14(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_16(M, T, a, ...) M(T, a) EMLITE_REFLECT_15(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_17(M, T, a, ...) M(T, a) EMLITE_REFLECT_16(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_18(M, T, a, ...) M(T, a) EMLITE_REFLECT_17(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_19(M, T, a, ...) M(T, a) EMLITE_REFLECT_18(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_20(M, T, a, ...) M(T, a) EMLITE_REFLECT_19(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_21(M, T, a, ...) M(T, a) EMLITE_REFLECT_20(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_22(M, T, a, ...) M(T, a) EMLITE_REFLECT_21(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_23(M, T, a, ...) M(T, a) EMLITE_REFLECT_22(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_24(M, T, a, ...) M(T, a) EMLITE_REFLECT_23(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_25(M, T, a, ...) M(T, a) EMLITE_REFLECT_24(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_26(M, T, a, ...) M(T, a) EMLITE_REFLECT_25(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_27(M, T, a, ...) M(T, a) EMLITE_REFLECT_26(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_28(M, T, a, ...) M(T, a) EMLITE_REFLECT_27(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_29(M, T, a, ...) M(T, a) EMLITE_REFLECT_28(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_30(M, T, a, ...) M(T, a) EMLITE_REFLECT_29(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_31(M, T, a, ...) M(T, a) EMLITE_REFLECT_30(M, T, __VA_ARGS__)
+#define EMLITE_REFLECT_32(M, T, a, ...) M(T, a) EMLITE_REFLECT_31(M, T, __VA_ARGS__)
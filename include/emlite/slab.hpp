@@ -0,0 +1,32 @@
+#pragma once
+
+#include <emcore/emcore.h>
+
+// A size-class slab allocator, tuned for emlite's allocation profile: closure
+// blocks, handle arrays and short strings of a few fixed sizes.
+//
+// Memory is taken from the emcore backend (emlite_malloc) in chunks of whole
+// wasm pages, so that every refill maps to memory.grow steps, and is split in
+// 16KiB slabs. Small requests are served from per-class slabs, larger ones
+// from runs of contiguous slabs. With EMLITE_USE_SLAB, freestanding builds
+// route operator new and delete to it.
+
+namespace emlite {
+/// Slab allocator counters, for measuring fragmentation
+struct SlabStats {
+    /// Bytes obtained from the backend
+    size_t footprint;
+    /// Bytes in allocated blocks, small blocks counted at their size class
+    size_t live;
+    /// Bytes of the slabs which are free for any use
+    size_t free_slabs;
+};
+
+/// Allocates `size` bytes, aligned to 16 bytes
+/// @returns the block, or null if the backend is out of memory
+void *slab_malloc(size_t size) noexcept;
+/// Frees a block allocated by slab_malloc, null being ignored
+void slab_free(void *p) noexcept;
+/// @returns the allocator counters
+[[nodiscard]] SlabStats slab_stats() noexcept;
+} // namespace emlite
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "emlite.hpp"
+
+// C++20 coroutine support: `co_await` on javascript promises from an emlite::Task.
+// Requires the <coroutine> header, so it isn't available in freestanding builds.
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#include <coroutine>
+#define EMLITE_HAVE_COROUTINES 1
+#else
+#define EMLITE_HAVE_COROUTINES 0
+#endif
+
+#if EMLITE_HAVE_COROUTINES
+namespace emlite {
+namespace detail {
+/// Allocates a coroutine frame from a pool of size classes
+void *frame_allocate(size_t size);
+/// Returns a coroutine frame to its pool
+void frame_deallocate(void *p, size_t size) noexcept;
+/// Calls `cb(data, value, fulfilled)` once the promise settles,
+/// value being an owned handle to the result or the rejection reason
+void promise_then(Handle promise, void (*cb)(void *, Handle, bool), void *data) noexcept;
+
+template <typename T>
+struct TaskResult {
+    Option<T> value_;
+
+    void return_value(T v) noexcept { value_ = Option<T>(move(v)); }
+    T take() noexcept { return move(*value_); }
+};
+
+template <>
+struct TaskResult<void> {
+    void return_void() noexcept {}
+    void take() noexcept {}
+};
+} // namespace detail
+
+/// The awaiter of `co_await val`.
+/// Attaches native `then` callbacks to the promise (other values are wrapped with
+/// `Promise.resolve`) and resumes the coroutine once it settles.
+class PromiseAwaiter {
+    Val promise_;
+    Handle result_  = 0;
+    bool fulfilled_ = false;
+    std::coroutine_handle<> h_;
+
+    static void settle(void *data, Handle value, bool fulfilled) noexcept {
+        auto self        = static_cast<PromiseAwaiter *>(data);
+        self->result_    = value;
+        self->fulfilled_ = fulfilled;
+        self->h_.resume();
+        emlite::flush();
+    }
+
+  public:
+    explicit PromiseAwaiter(Val promise) noexcept : promise_(detail::move(promise)) {}
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) noexcept {
+        h_ = h;
+        detail::promise_then(promise_.as_handle(), &PromiseAwaiter::settle, this);
+    }
+    /// @returns the fulfilled value, or the rejection reason as the error
+    Result<Val, Val> await_resume() noexcept {
+        auto v = Val::take_ownership(result_);
+        if (fulfilled_)
+            return ok<Val, Val>(detail::move(v));
+        return err<Val, Val>(detail::move(v));
+    }
+};
+
+/// Awaits a javascript promise, or any value through `Promise.resolve`
+inline PromiseAwaiter operator co_await(Val v) noexcept { return PromiseAwaiter(detail::move(v)); }
+
+/// A coroutine returning T, which can `co_await` javascript promises and other Tasks.
+/// Like a javascript async function, a Task starts running immediately and runs
+/// until its first suspension. Dropping a Task which hasn't finished detaches it,
+/// its frame is then freed once it completes. Frames are allocated from a pool.
+template <typename T = void>
+class Task {
+  public:
+    struct promise_type : detail::TaskResult<T> {
+        std::coroutine_handle<> continuation_;
+        bool detached_ = false;
+
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h
+            ) noexcept {
+                auto &p = h.promise();
+                if (p.continuation_)
+                    return p.continuation_;
+                if (p.detached_)
+                    h.destroy();
+                return std::noop_coroutine();
+            }
+            void await_resume() const noexcept {}
+        };
+
+        Task get_return_object() noexcept {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() const noexcept { __builtin_trap(); }
+
+        static void *operator new(size_t size) { return detail::frame_allocate(size); }
+        static void operator delete(void *p, size_t size) noexcept {
+            detail::frame_deallocate(p, size);
+        }
+    };
+
+  private:
+    std::coroutine_handle<promise_type> h_;
+
+    explicit Task(std::coroutine_handle<promise_type> h) noexcept : h_(h) {}
+
+    struct Awaiter {
+        std::coroutine_handle<promise_type> h_;
+
+        // An empty or moved-from Task is done, without a result
+        bool await_ready() const noexcept { return !h_ || h_.done(); }
+        void await_suspend(std::coroutine_handle<> continuation) noexcept {
+            h_.promise().continuation_ = continuation;
+        }
+        T await_resume() noexcept {
+            if constexpr (!detail::is_same_v<T, void>) {
+                if (!h_) {
+                    Val::throw_(Val::intrinsic(Intrinsic::Error).new_("Task has no value"));
+                    __builtin_trap();
+                }
+                return h_.promise().take();
+            }
+        }
+    };
+
+  public:
+    /// An empty Task, which is done
+    Task() noexcept = default;
+    Task(const Task &)            = delete;
+    Task &operator=(const Task &) = delete;
+    Task(Task &&other) noexcept : h_(other.h_) { other.h_ = nullptr; }
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            reset();
+            h_       = other.h_;
+            other.h_ = nullptr;
+        }
+        return *this;
+    }
+    ~Task() { reset(); }
+
+    /// @returns whether the coroutine ran to completion
+    [[nodiscard]] bool done() const noexcept { return !h_ || h_.done(); }
+
+    /// Awaits the result of the Task from another coroutine. Awaiting an
+    /// empty Task returns at once, or throws a javascript Error if T isn't void.
+    Awaiter operator co_await() noexcept { return Awaiter{h_}; }
+
+  private:
+    void reset() noexcept {
+        if (!h_)
+            return;
+        if (h_.done())
+            h_.destroy();
+        else
+            h_.promise().detached_ = true;
+        h_ = nullptr;
+    }
+};
+} // namespace emlite
+#endif
@@ -19,11 +19,14 @@ function buildSet(label, binDir, toolchain) {
     `-B${binDir}`,
     "-GNinja",
     "-DEMLITE_BUILD_EXAMPLES=ON",
+    "-DEMLITE_BUILD_BENCH=ON",
     "-DCMAKE_BUILD_TYPE=MinSizeRel",
     `-DCMAKE_TOOLCHAIN_FILE=${toolchain}`,
   ];
   if (label === "FREESTANDING_WITH_DLMALLOC")
     cmd.push("-DEMLITE_USE_DLMALLOC=ON");
+  if (label === "FREESTANDING_WITH_SLAB")
+    cmd.push("-DEMLITE_USE_SLAB=ON");
   if (label === "EMSCRIPTEN_STANDALONE")
     cmd.push("-DEMSCRIPTEN_STANDALONE_WASM=ON");
   run(cmd.join(" "));
@@ -41,6 +44,12 @@ async function main() {
       "./cmake/freestanding.cmake"
     );
 
+    buildSet(
+      "FREESTANDING_WITH_SLAB",
+      "bin/freestanding_slab",
+      "./cmake/freestanding.cmake"
+    );
+
     const { WASI_SDK, WASI_SYSROOT, WASI_LIBC, EMSCRIPTEN_ROOT } = process.env;
 
     // 2- WASI SDK
@@ -26,7 +26,7 @@ function bundleWasm(wasmPath) {
     fs.writeFileSync(
       wrapper,
       `
-            import { Emlite } from "../../../node_modules/emlite/src/emlite.js";
+            import { Emlite } from "../../../scripts/index.js";
 
             async function main() {
                 const emlite = new Emlite();
@@ -50,7 +50,7 @@ function bundleWasm(wasmPath) {
     fs.writeFileSync(
       wrapper,
       `
-            import { Emlite } from "../../../node_modules/emlite/src/emlite.js";
+            import { Emlite } from "../../../scripts/index.js";
             import { WASI, File, OpenFile, ConsoleStdout } from "@bjorn3/browser_wasi_shim";
 
             async function main() {
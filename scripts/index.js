@@ -1 +1,788 @@
-// Wow, such empty
\ No newline at end of file
+// JS runtime for emlite-cpp.
+// Extends the Emlite loader from the emlite package with the imports used by the
+// C++ api (see include/emlite/detail/imports.hpp). Use it in place of the base class:
+//
+//   import { Emlite } from "emlite-cpp";
+//   const emlite = new Emlite();
+//   const inst = await WebAssembly.instantiate(wasm, { env: emlite.env });
+//   emlite.setExports(inst.exports);
+
+/* global EMLITE_VALMAP */
+
+import { Emlite as EmliteBase } from "emlite";
+
+export class Emlite extends EmliteBase {
+  #exports = null;
+  #buffer = null;
+  #u8 = null;
+  #u32 = null;
+  #view = null;
+  #decoder = new TextDecoder("utf-8");
+  #encoder = new TextEncoder();
+  #closures = new WeakMap();
+  #cmdSlots = new Map();
+  #extractors = new Map();
+  #registry = new FinalizationRegistry((rec) => Emlite.#drop(rec));
+
+  static #drop(rec) {
+    if (!rec.data) return;
+    const data = rec.data;
+    rec.data = 0;
+    rec.drop(data);
+  }
+
+  constructor(opts = {}) {
+    super(opts);
+    // `env` might be an own property or an accessor on the base class,
+    // so redefine it on the instance rather than assigning to it.
+    Object.defineProperty(this, "env", {
+      value: { ...this.env, ...this.#cppEnv() },
+      writable: true,
+      enumerable: true,
+      configurable: true,
+    });
+  }
+
+  setExports(exports) {
+    super.setExports(exports);
+    this.#exports = exports;
+  }
+
+  // Names of the emlite::Crossing kinds, in order
+  static #crossings = [
+    "get",
+    "set",
+    "has",
+    "call",
+    "new",
+    "create",
+    "toJs",
+    "fromJs",
+    "stringToJs",
+    "stringFromJs",
+    "typeCheck",
+    "compare",
+    "function",
+    "typedArray",
+    "refcount",
+    "other",
+  ];
+
+  // Reads the emlite::Stats of a module built with EMLITE_STATS, null otherwise.
+  // Pass `reset` to reset the counters after reading them.
+  stats(reset = false) {
+    const ptr = this.#exports?.emlite_stats_data?.();
+    if (ptr === undefined) return null;
+    this.#refresh();
+    const view = new DataView(this.#buffer, ptr >>> 0);
+    const u64 = (i) => Number(view.getBigUint64(i * 8, true));
+    const i64 = (i) => Number(view.getBigInt64(i * 8, true));
+    const calls = {};
+    Emlite.#crossings.forEach((name, i) => (calls[name] = u64(6 + i)));
+    const stats = {
+      crossings: u64(0),
+      handlesCreated: u64(1),
+      liveHandles: i64(2),
+      peakLiveHandles: i64(3),
+      bytesToJs: u64(4),
+      bytesFromJs: u64(5),
+      calls,
+    };
+    if (reset) this.#exports.emlite_stats_reset();
+    return stats;
+  }
+
+  // Memory views are recreated whenever memory.grow detaches the old buffer.
+  #refresh() {
+    const buffer = this.#exports.memory.buffer;
+    if (buffer !== this.#buffer) {
+      this.#buffer = buffer;
+      this.#u8 = new Uint8Array(buffer);
+      this.#u32 = new Uint32Array(buffer);
+      this.#view = new DataView(buffer);
+    }
+  }
+
+  #str(ptr, len) {
+    this.#refresh();
+    return this.#decoder.decode(this.#u8.subarray(ptr >>> 0, (ptr >>> 0) + (len >>> 0)));
+  }
+
+  #cstr(ptr) {
+    this.#refresh();
+    const start = ptr >>> 0;
+    return this.#str(start, this.#u8.indexOf(0, start) - start);
+  }
+
+  static #string(handle) {
+    const v = EMLITE_VALMAP.toValue(handle);
+    return typeof v === "string" ? v : String(v);
+  }
+
+  // UTF-8 length of s from the code unit at `from`
+  static #utf8Length(s, from) {
+    let n = 0;
+    for (let i = from; i < s.length; i++) {
+      const c = s.charCodeAt(i);
+      if (c < 0x80) n += 1;
+      else if (c < 0x800) n += 2;
+      else if (c >= 0xd800 && c <= 0xdbff && i + 1 < s.length) {
+        const d = s.charCodeAt(i + 1);
+        if (d >= 0xdc00 && d <= 0xdfff) {
+          n += 4;
+          i++;
+        } else n += 3;
+      } else n += 3;
+    }
+    return n;
+  }
+
+  // Formats a value for one printf placeholder, the way snprintf formatted the
+  // placeholders which EMLITE_EVAL snippets have inside literals
+  static #printf(spec, v) {
+    const [, flags, width, prec, conv] =
+      /^%([-+ #0]*)(\d*)(?:\.(\d+))?(?:hh|h|ll|l|j|z|t|L)?(.)$/.exec(spec);
+    const p = prec === undefined ? undefined : Number(prec);
+    const upper = conv === conv.toUpperCase();
+    let sign = "";
+    let s;
+    const signOf = (negative) => (negative ? "-" : flags.includes("+") ? "+" : flags.includes(" ") ? " " : "");
+    switch (conv) {
+      case "d":
+      case "i": {
+        const n = typeof v === "bigint" ? v : Math.trunc(Number(v));
+        sign = signOf(n < 0);
+        s = (n < 0 ? -n : n).toString();
+        if (p !== undefined) s = s.padStart(p, "0");
+        break;
+      }
+      case "u":
+      case "o":
+      case "x":
+      case "X": {
+        const n = typeof v === "bigint" ? BigInt.asUintN(64, v) : Number(v) >>> 0;
+        s = n.toString(conv === "u" ? 10 : conv === "o" ? 8 : 16);
+        if (p !== undefined) s = s.padStart(p, "0");
+        if (flags.includes("#") && n) s = (conv === "o" ? "0" : "0x") + s;
+        if (upper) s = s.toUpperCase();
+        break;
+      }
+      case "c":
+        s = String.fromCharCode(Number(v));
+        break;
+      case "s":
+        s = String(v);
+        if (p !== undefined) s = s.slice(0, p);
+        break;
+      case "p":
+        s = "0x" + (Number(v) >>> 0).toString(16);
+        break;
+      default: {
+        const n = Number(v);
+        sign = signOf(n < 0 || Object.is(n, -0));
+        const a = Math.abs(n);
+        const exp = (x, digits) => x.toExponential(digits).replace(/e([+-])(\d)$/, "e$10$2");
+        if (!Number.isFinite(a)) s = Number.isNaN(a) ? "nan" : "inf";
+        else if (conv === "f" || conv === "F") s = a.toFixed(p ?? 6);
+        else if (conv === "e" || conv === "E") s = exp(a, p ?? 6);
+        else if (conv === "g" || conv === "G") {
+          const digits = p === 0 ? 1 : p ?? 6;
+          const x = a === 0 ? 0 : Math.floor(Math.log10(Number(a.toPrecision(digits))));
+          s = x < -4 || x >= digits ? exp(a, digits - 1) : a.toFixed(digits - 1 - x);
+          if (!flags.includes("#") && s.includes("."))
+            s = s.replace(/\.?0+(?=e|$)/, "");
+        } else s = a.toString(16);
+        if (upper) s = s.toUpperCase();
+      }
+    }
+    const pad = Number(width || 0) - sign.length - s.length;
+    if (pad <= 0) return sign + s;
+    if (flags.includes("-")) return sign + s + " ".repeat(pad);
+    if (flags.includes("0") && !"csp".includes(conv) && !(p !== undefined && "diouxX".includes(conv)))
+      return sign + "0".repeat(pad) + s;
+    return " ".repeat(pad) + sign + s;
+  }
+
+  // Words after which a `/` starts a regex literal rather than a division
+  static #regexAfter =
+    /(?:^|[^\w$])(?:return|typeof|instanceof|in|of|new|delete|void|throw|case|do|else|yield|await)$/;
+
+  // Rewrites an EMLITE_EVAL snippet into a function body. printf-style placeholders
+  // become the parameters $0, $1... in order. In code they stand for the values
+  // themselves. Inside string, template and regex literals they are formatted by
+  // $fmt like snprintf would have, and spliced in by concatenation. Also records
+  // where the top-level statements start, and where the first top-level bracket
+  // closes.
+  static #transformEval(src) {
+    const spec = /^%[-+ #0]*\d*(?:\.\d+)?(?:hh|h|ll|l|j|z|t|L)?[diouxXeEfFgGaAcsp]/;
+    const templates = []; // bracket depths of the template literals left through `${`
+    let out = "";
+    let params = 0;
+    let depth = 0;
+    const stmts = [0];
+    let firstClose = -1;
+    let quote = null;
+    // The placeholder at i formatted for a literal, or null
+    const formatted = (i) => {
+      const m = spec.exec(src.slice(i));
+      return m && { expr: `$fmt(${JSON.stringify(m[0])}, $${params++})`, len: m[0].length };
+    };
+    const regexAllowed = () => {
+      const prev = out.trimEnd();
+      const c = prev[prev.length - 1];
+      if (c === undefined) return true;
+      // `x++ / 2`: a prefix ++ or -- can't be followed by a regex
+      if (/(?:\+\+|--)$/.test(prev)) return false;
+      if (/[\w$]/.test(c)) return Emlite.#regexAfter.test(prev);
+      return !")]}'\"`".includes(c);
+    };
+    for (let i = 0; i < src.length; ) {
+      const c = src[i];
+      if (c === "%" && src[i + 1] === "%") {
+        out += "%";
+        i += 2;
+        continue;
+      }
+      if (quote) {
+        if (c === "%") {
+          const f = formatted(i);
+          if (f) {
+            out += quote === "`" ? "${" + f.expr + "}" : `${quote} + ${f.expr} + ${quote}`;
+            i += f.len;
+            continue;
+          }
+        }
+        if (c === "\\") {
+          out += src.slice(i, i + 2);
+          i += 2;
+          continue;
+        }
+        if (c === quote) {
+          quote = null;
+        } else if (quote === "`" && c === "$" && src[i + 1] === "{") {
+          templates.push(depth++);
+          quote = null;
+          out += "${";
+          i += 2;
+          continue;
+        }
+        out += c;
+        i++;
+        continue;
+      }
+      if (c === "%") {
+        const m = spec.exec(src.slice(i));
+        if (m) {
+          out += `$${params++}`;
+          i += m[0].length;
+          continue;
+        }
+      }
+      if (c === "/" && (src[i + 1] === "/" || src[i + 1] === "*")) {
+        // Comments are kept, their placeholders still take an argument like for snprintf
+        const end = src[i + 1] === "/" ? src.indexOf("\n", i) : src.indexOf("*/", i + 2) + 2;
+        const stop = end < i + 2 ? src.length : end;
+        const text = src.slice(i, stop);
+        for (let j = 0; j < text.length; j++) {
+          const m = text[j] === "%" && text[j + 1] !== "%" && spec.exec(text.slice(j));
+          if (m) params++;
+          if (text[j] === "%") j++;
+        }
+        out += text;
+        i = stop;
+        continue;
+      }
+      if (c === "/" && regexAllowed()) {
+        // A regex literal, rebuilt with `new RegExp` if it has placeholders
+        const parts = [];
+        let body = "";
+        let cls = false;
+        let j = i + 1;
+        for (; j < src.length; ) {
+          const d = src[j];
+          if (d === "%") {
+            if (src[j + 1] === "%") {
+              body += "%";
+              j += 2;
+              continue;
+            }
+            const f = formatted(j);
+            if (f) {
+              parts.push(JSON.stringify(body), f.expr);
+              body = "";
+              j += f.len;
+              continue;
+            }
+          }
+          if (d === "\\") {
+            body += src.slice(j, j + 2);
+            j += 2;
+            continue;
+          }
+          if (d === "/" && !cls) break;
+          if (d === "[") cls = true;
+          else if (d === "]") cls = false;
+          body += d;
+          j++;
+        }
+        const regexFlags = /^[a-z]*/.exec(src.slice(j + 1))[0];
+        if (parts.length) {
+          parts.push(JSON.stringify(body));
+          out += `new RegExp(${parts.join(" + ")}, "${regexFlags}")`;
+        } else {
+          out += `/${body}/${regexFlags}`;
+        }
+        i = j + 1 + regexFlags.length;
+        continue;
+      }
+      if (c === "'" || c === '"' || c === "`") {
+        quote = c;
+      } else if (c === "{" || c === "(" || c === "[") {
+        depth++;
+      } else if (c === "}" || c === ")" || c === "]") {
+        depth--;
+        if (c === "}" && templates.length && templates[templates.length - 1] === depth) {
+          templates.pop();
+          quote = "`";
+        } else if (depth === 0 && firstClose < 0) {
+          firstClose = i;
+        }
+      }
+      out += c;
+      i++;
+      if (depth === 0 && !quote && (c === ";" || c === "}")) stmts.push(out.length);
+    }
+    return { out, params, stmts, firstClose };
+  }
+
+  // Compiles an EMLITE_EVAL snippet once into a function. Like eval, it returns
+  // the value of a trailing expression statement. A trailing block, if, loop,
+  // switch or try has a completion value only eval computes, so such snippets
+  // are run by a direct eval of the rewritten body, which still sees the
+  // parameters.
+  static #compileEval(src) {
+    src = src.trim();
+    let t = Emlite.#transformEval(src);
+    // EMLITE_EVAL({ ... }) wraps the whole snippet in a block
+    if (src[0] === "{" && t.firstClose === src.length - 1)
+      t = Emlite.#transformEval(src.slice(1, -1).trim());
+    let body = t.out;
+    const stmt = (k) => body.slice(t.stmts[k], t.stmts[k + 1]).trim();
+    // The last statement, along with the else, catch and finally clauses it ends with
+    let last = t.stmts.length - 1;
+    while (last > 0 && !stmt(last)) last--;
+    while (last > 0 && /^(?:else|catch|finally)\b/.test(stmt(last))) last--;
+    const tail = body.slice(t.stmts[last]).trim();
+    const statement =
+      /^(?:let|const|var|function|class|if|for|while|do|switch|try|return|throw|break|continue)\b/;
+    if (/^(?:\{|(?:if|for|while|do|switch|try)\b)/.test(tail))
+      body = `return eval(${JSON.stringify(body)});`;
+    else if (tail && !statement.test(tail))
+      body = `${body.slice(0, t.stmts[last])} return (${tail.replace(/;$/, "")});`;
+    const params = Array.from({ length: t.params }, (_, i) => `$${i}`);
+    return new Function("$fmt", `return function (${params.join(", ")}) {\n${body}\n};`)(
+      Emlite.#printf
+    );
+  }
+
+  // Getter and setter expressions of the EMLITE_REFLECT field kinds, indexed by
+  // emlite::detail::FieldKind. Strings are only converted to javascript.
+  static #fieldAccess = [
+    [(at) => `d.getInt8(${at})`, (at, v) => `d.setInt8(${at}, ${v})`],
+    [(at) => `d.getUint8(${at})`, (at, v) => `d.setUint8(${at}, ${v})`],
+    [(at) => `d.getInt16(${at}, true)`, (at, v) => `d.setInt16(${at}, ${v}, true)`],
+    [(at) => `d.getUint16(${at}, true)`, (at, v) => `d.setUint16(${at}, ${v}, true)`],
+    [(at) => `d.getInt32(${at}, true)`, (at, v) => `d.setInt32(${at}, ${v}, true)`],
+    [(at) => `d.getUint32(${at}, true)`, (at, v) => `d.setUint32(${at}, ${v}, true)`],
+    [(at) => `d.getBigInt64(${at}, true)`, (at, v) => `d.setBigInt64(${at}, big(${v}), true)`],
+    [(at) => `d.getBigUint64(${at}, true)`, (at, v) => `d.setBigUint64(${at}, big(${v}), true)`],
+    [(at) => `d.getFloat32(${at}, true)`, (at, v) => `d.setFloat32(${at}, ${v}, true)`],
+    [(at) => `d.getFloat64(${at}, true)`, (at, v) => `d.setFloat64(${at}, ${v}, true)`],
+    [(at) => `d.getUint8(${at}) !== 0`, (at, v) => `d.setUint8(${at}, ${v} ? 1 : 0)`],
+    [(at) => `cstr(d.getUint32(${at}, true))`, null],
+    [(at) => `str(d.getUint32(${at}, true), d.getUint32(${at} + 4, true))`, null],
+  ];
+
+  // Compiles the reader and writer of an EMLITE_REFLECT struct from its field
+  // table. Objects are made by a single literal listing the fields in order,
+  // so all the objects of a shape share a hidden class.
+  #defineShape(fields, count, size) {
+    this.#refresh();
+    const make = [];
+    const read = [];
+    for (let i = 0; i < count; i++) {
+      const base = (fields >>> 0) + i * 12;
+      const key = JSON.stringify(this.#cstr(this.#view.getUint32(base, true)));
+      const at = `p + ${this.#view.getUint32(base + 4, true)}`;
+      const [get, set] = Emlite.#fieldAccess[this.#view.getUint32(base + 8, true)];
+      make.push(`${key}: ${get(at)}`);
+      if (set) read.push(`${set(at, `o[${key}]`)};`);
+    }
+    const makeSrc = `(d, p) => ({ ${make.join(", ")} })`;
+    const readSrc = `(d, p, o) => { if (o == null) return; ${read.join(" ")} }`;
+    const [makeFn, readFn] = new Function("str", "cstr", "big", `return [${makeSrc}, ${readSrc}];`)(
+      (ptr, len) => this.#str(ptr, len),
+      (ptr) => (ptr ? this.#cstr(ptr) : null),
+      Emlite.#big
+    );
+    return { size, make: makeFn, read: readFn };
+  }
+
+  static #big(v) {
+    return typeof v === "bigint" ? v : BigInt(Math.trunc(Number(v)) || 0);
+  }
+
+  // TypedArrays of the Val::extract_columns column kinds, indexed by
+  // emlite::detail::FieldKind
+  static #columnArrays = [
+    Int8Array,
+    Uint8Array,
+    Int16Array,
+    Uint16Array,
+    Int32Array,
+    Uint32Array,
+    BigInt64Array,
+    BigUint64Array,
+    Float32Array,
+    Float64Array,
+    Uint8Array,
+  ];
+
+  // Compiles the loop of Val::extract_columns for a set of keys, reading each
+  // property by name so that rows of one shape stay monomorphic. The values of
+  // a row are read and converted first, since getters and valueOf can call
+  // into wasm and grow the memory, then the views are checked before writing.
+  static #compileExtractor(keys, kinds) {
+    const cols = keys.map((_, c) => `c${c}`);
+    const read = keys.map((key, c) => {
+      const v = `r?.[${JSON.stringify(key)}]`;
+      if (kinds[c] === 6 || kinds[c] === 7) return `const v${c} = big(${v});`;
+      if (kinds[c] === 10) return `const v${c} = ${v} ? 1 : 0;`;
+      return `const v${c} = +${v};`;
+    });
+    const write = keys.map((_, c) => `c${c}[i] = v${c};`);
+    const remake = `if (mem.buffer !== buffer) { buffer = mem.buffer; [${cols.join(", ")}] = views(buffer); }`;
+    const loop = `for (let i = 0; i < n; i++) { const r = a[i]; ${read.join(" ")} ${remake} ${write.join(" ")} }`;
+    const body = `let buffer = mem.buffer; let [${cols.join(", ")}] = views(buffer); ${loop}`;
+    return new Function("big", `return (a, n, mem, views) => { ${body} };`)(Emlite.#big);
+  }
+
+  #args(argv, argc) {
+    this.#refresh();
+    const base = (argv >>> 0) >>> 2;
+    const args = new Array(argc >>> 0);
+    for (let i = 0; i < args.length; i++) args[i] = EMLITE_VALMAP.toValue(this.#u32[base + i]);
+    return args;
+  }
+
+  #cppEnv() {
+    return {
+      emlite_val_obj_call_argv: (obj, name, len, argv, argc) => {
+        const o = EMLITE_VALMAP.toValue(obj);
+        const fn = o[this.#str(name, len)];
+        return EMLITE_VALMAP.toHandle(Reflect.apply(fn, o, this.#args(argv, argc)));
+      },
+      emlite_val_obj_call_key_argv: (obj, key, argv, argc) => {
+        const o = EMLITE_VALMAP.toValue(obj);
+        const fn = o[EMLITE_VALMAP.toValue(key)];
+        return EMLITE_VALMAP.toHandle(Reflect.apply(fn, o, this.#args(argv, argc)));
+      },
+      emlite_val_func_call_argv: (fn, argv, argc) =>
+        EMLITE_VALMAP.toHandle(
+          Reflect.apply(EMLITE_VALMAP.toValue(fn), undefined, this.#args(argv, argc))
+        ),
+      emlite_val_construct_new_argv: (ctor, argv, argc) =>
+        EMLITE_VALMAP.toHandle(
+          Reflect.construct(EMLITE_VALMAP.toValue(ctor), this.#args(argv, argc))
+        ),
+      emlite_val_typed_array_view: (ctor, ptr, len) => {
+        const TypedArray = EMLITE_VALMAP.toValue(ctor);
+        return EMLITE_VALMAP.toHandle(
+          new TypedArray(this.#exports.memory.buffer, ptr >>> 0, len >>> 0)
+        );
+      },
+      emlite_val_typed_array_copy: (ctor, ptr, len) => {
+        const TypedArray = EMLITE_VALMAP.toValue(ctor);
+        return EMLITE_VALMAP.toHandle(
+          new TypedArray(this.#exports.memory.buffer, ptr >>> 0, len >>> 0).slice()
+        );
+      },
+      emlite_val_typed_array_adopt: (ctor, ptr, len, dropidx) => {
+        const TypedArray = EMLITE_VALMAP.toValue(ctor);
+        const view = new TypedArray(this.#exports.memory.buffer, ptr >>> 0, len >>> 0);
+        // The record must not reference the view, or it would never be collected
+        const rec = { drop: this.#exports.__indirect_function_table.get(dropidx >>> 0), data: ptr };
+        this.#registry.register(view, rec);
+        return EMLITE_VALMAP.toHandle(view);
+      },
+      emlite_val_copy_to: (src, ctor, dst, cap) => {
+        const from = EMLITE_VALMAP.toValue(src);
+        const TypedArray = EMLITE_VALMAP.toValue(ctor);
+        const n = Math.min(from.length, cap >>> 0);
+        const to = new TypedArray(this.#exports.memory.buffer, dst >>> 0, n);
+        // BigInt and number elements don't convert implicitly into each other
+        const bigTo = to instanceof BigInt64Array || to instanceof BigUint64Array;
+        const bigFrom = from instanceof BigInt64Array || from instanceof BigUint64Array;
+        if (ArrayBuffer.isView(from) && bigTo === bigFrom) {
+          to.set(n === from.length ? from : from.subarray(0, n));
+        } else if (bigTo) {
+          for (let i = 0; i < n; i++) to[i] = Emlite.#big(from[i]);
+        } else {
+          for (let i = 0; i < n; i++) to[i] = Number(from[i]);
+        }
+        return n;
+      },
+      emlite_val_make_closure: (fidx, dropidx, data, slot, cap) => {
+        const table = this.#exports.__indirect_function_table;
+        const fn = table.get(fidx >>> 0);
+        const base = (slot >>> 0) >>> 2;
+        // The record must not reference the function, or it would never be collected
+        const rec = { drop: table.get(dropidx >>> 0), data };
+        const closure = (...args) => {
+          if (!rec.data) throw new Error("emlite: called a disposed function");
+          const argc = Math.min(args.length, cap >>> 0);
+          this.#refresh();
+          for (let i = 0; i < argc; i++) this.#u32[base + i] = EMLITE_VALMAP.toHandle(args[i]);
+          const ret = fn(rec.data, slot, argc);
+          const value = EMLITE_VALMAP.toValue(ret);
+          this.env.emlite_val_dec_ref(ret);
+          return value;
+        };
+        this.#closures.set(closure, rec);
+        this.#registry.register(closure, rec, rec);
+        return EMLITE_VALMAP.toHandle(closure);
+      },
+      emlite_val_dispose_closure: (fn) => {
+        const rec = this.#closures.get(EMLITE_VALMAP.toValue(fn));
+        if (!rec) return;
+        this.#registry.unregister(rec);
+        Emlite.#drop(rec);
+      },
+      emlite_val_dec_ref_batch: (ptr, n) => {
+        this.#refresh();
+        const base = (ptr >>> 0) >>> 2;
+        for (let i = 0; i < n >>> 0; i++) this.env.emlite_val_dec_ref(this.#u32[base + i]);
+      },
+      emlite_val_str_utf8_into: (str, dst, cap) => {
+        const s = Emlite.#string(str);
+        this.#refresh();
+        const start = dst >>> 0;
+        const { read, written } = this.#encoder.encodeInto(
+          s,
+          this.#u8.subarray(start, start + (cap >>> 0))
+        );
+        return read === s.length ? written : written + Emlite.#utf8Length(s, read);
+      },
+      emlite_val_str_compare: (str, ptr, len) => {
+        const a = Emlite.#string(str);
+        const b = this.#str(ptr, len);
+        let i = 0;
+        let j = 0;
+        while (i < a.length && j < b.length) {
+          const x = a.codePointAt(i);
+          const y = b.codePointAt(j);
+          if (x !== y) return x < y ? -1 : 1;
+          i += x > 0xffff ? 2 : 1;
+          j += y > 0xffff ? 2 : 1;
+        }
+        return i < a.length ? 1 : j < b.length ? -1 : 0;
+      },
+      emlite_val_str_starts_with: (str, ptr, len) =>
+        Emlite.#string(str).startsWith(this.#str(ptr, len)),
+      emlite_val_promise_then: (promise, fidx, data) => {
+        const fn = this.#exports.__indirect_function_table.get(fidx >>> 0);
+        Promise.resolve(EMLITE_VALMAP.toValue(promise)).then(
+          (v) => fn(data, EMLITE_VALMAP.toHandle(v), 1),
+          (e) => fn(data, EMLITE_VALMAP.toHandle(e), 0)
+        );
+      },
+      // Values of emlite::Kind
+      emlite_val_kind: (h) => {
+        const v = EMLITE_VALMAP.toValue(h);
+        switch (typeof v) {
+          case "undefined":
+            return 0;
+          case "boolean":
+            return 2;
+          case "number":
+            return 3;
+          case "bigint":
+            return 4;
+          case "string":
+            return 5;
+          case "symbol":
+            return 6;
+          case "function":
+            return 7;
+        }
+        if (v === null) return 1;
+        if (Array.isArray(v)) return 8;
+        if (ArrayBuffer.isView(v) && !(v instanceof DataView)) return 9;
+        if (v instanceof Error) return 10;
+        return 11;
+      },
+      // Interprets the command stream of emlite::CommandBuffer, see command_buffer.hpp
+      emlite_cmd_flush: (id, ptr, len) => {
+        const slots = [];
+        let u32 = null;
+        let view = null;
+        // Word index, byte offsets are i * 4 since i << 2 wraps above 2GB
+        let i = (ptr >>> 0) >>> 2;
+        const end = i + (len >>> 0);
+        // Commands can run wasm code (custom elements, setters), which might grow memory
+        const sync = () => {
+          this.#refresh();
+          if (u32 !== this.#u32) {
+            u32 = this.#u32;
+            view = new DataView(this.#buffer);
+          }
+        };
+        const str = () => {
+          const n = u32[i++];
+          const s = this.#str(i * 4, n);
+          i += (n + 3) >>> 2;
+          return s;
+        };
+        const value = () => {
+          switch (u32[i++]) {
+            case 0:
+              return undefined;
+            case 1:
+              return null;
+            case 2:
+              return false;
+            case 3:
+              return true;
+            case 4:
+              return u32[i++] | 0;
+            case 5: {
+              const d = view.getFloat64(i * 4, true);
+              i += 2;
+              return d;
+            }
+            case 6:
+              return str();
+            case 7:
+              return EMLITE_VALMAP.toValue(u32[i++]);
+            case 8:
+              return slots[u32[i++]];
+            default:
+              throw new Error("emlite: bad command operand");
+          }
+        };
+        while (i < end) {
+          sync();
+          switch (u32[i++]) {
+            case 0: {
+              const slot = u32[i++];
+              i++; // string tag
+              slots[slot] = globalThis.document.createElement(str());
+              break;
+            }
+            case 1: {
+              const target = value();
+              const key = value();
+              target[key] = value();
+              break;
+            }
+            case 2: {
+              const slot = u32[i++];
+              const target = value();
+              i++; // string tag
+              const method = str();
+              const args = new Array(u32[i++]);
+              for (let a = 0; a < args.length; a++) args[a] = value();
+              slots[slot] = target[method](...args);
+              break;
+            }
+            case 3: {
+              const parent = value();
+              parent.appendChild(value());
+              break;
+            }
+            case 4: {
+              const target = value();
+              i++; // string tag
+              const name = str();
+              target.setAttribute(name, value());
+              break;
+            }
+            default:
+              throw new Error("emlite: bad command");
+          }
+        }
+        this.#cmdSlots.set(id, slots);
+      },
+      emlite_cmd_get: (id, slot) => EMLITE_VALMAP.toHandle(this.#cmdSlots.get(id)?.[slot]),
+      emlite_cmd_release: (id) => {
+        this.#cmdSlots.delete(id);
+      },
+      emlite_val_shape_define: (fields, count, size) =>
+        EMLITE_VALMAP.toHandle(this.#defineShape(fields, count >>> 0, size >>> 0)),
+      emlite_val_shape_make: (shape, ptr) => {
+        const s = EMLITE_VALMAP.toValue(shape);
+        this.#refresh();
+        return EMLITE_VALMAP.toHandle(s.make(this.#view, ptr >>> 0));
+      },
+      emlite_val_shape_read: (shape, obj, ptr) => {
+        const s = EMLITE_VALMAP.toValue(shape);
+        const o = EMLITE_VALMAP.toValue(obj);
+        this.#refresh();
+        s.read(this.#view, ptr >>> 0, o);
+      },
+      emlite_val_shape_make_array: (shape, ptr, n) => {
+        const s = EMLITE_VALMAP.toValue(shape);
+        this.#refresh();
+        const out = new Array(n >>> 0);
+        for (let i = 0, p = ptr >>> 0; i < out.length; i++, p += s.size)
+          out[i] = s.make(this.#view, p);
+        return EMLITE_VALMAP.toHandle(out);
+      },
+      emlite_val_shape_read_array: (shape, arr, ptr, cap) => {
+        const s = EMLITE_VALMAP.toValue(shape);
+        const a = EMLITE_VALMAP.toValue(arr);
+        const n = Math.min(a.length, cap >>> 0);
+        this.#refresh();
+        for (let i = 0, p = ptr >>> 0; i < n; i++, p += s.size) s.read(this.#view, p, a[i]);
+        return n;
+      },
+      emlite_val_extract_columns: (arr, cols, ncols, rows) => {
+        const a = EMLITE_VALMAP.toValue(arr);
+        const n = rows >>> 0;
+        const keys = [];
+        const kinds = [];
+        const dsts = [];
+        this.#refresh();
+        for (let c = 0; c < ncols >>> 0; c++) {
+          const base = (cols >>> 0) + c * 16;
+          const key = this.#view.getUint32(base, true);
+          const keyLen = this.#view.getUint32(base + 4, true);
+          kinds.push(this.#view.getUint32(base + 8, true));
+          dsts.push(this.#view.getUint32(base + 12, true));
+          keys.push(this.#str(key, keyLen));
+        }
+        const id = `${kinds.join(",")}:${JSON.stringify(keys)}`;
+        let extract = this.#extractors.get(id);
+        if (!extract) {
+          extract = Emlite.#compileExtractor(keys, kinds);
+          this.#extractors.set(id, extract);
+        }
+        // The column views, made again whenever a getter grows the memory
+        const views = (buffer) => dsts.map((dst, c) => new Emlite.#columnArrays[kinds[c]](buffer, dst, n));
+        extract(a, n, this.#exports.memory, views);
+      },
+      emlite_val_compile_eval: (ptr, len) =>
+        EMLITE_VALMAP.toHandle(Emlite.#compileEval(this.#str(ptr, len))),
+      emlite_val_make_str_ascii: (ptr, len) => {
+        // Building a short string directly beats a TextDecoder call.
+        // detail::make_str only passes strings of up to 12 bytes.
+        this.#refresh();
+        const start = ptr >>> 0;
+        const end = start + (len >>> 0);
+        let s = "";
+        for (let i = start; i < end; i++) s += String.fromCharCode(this.#u8[i]);
+        return EMLITE_VALMAP.toHandle(s);
+      },
+    };
+  }
+}
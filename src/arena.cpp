@@ -0,0 +1,97 @@
+#include <emlite/emlite.hpp>
+
+namespace emlite {
+FrameScope *FrameScope::top_ = nullptr;
+
+namespace {
+// Never freed, like the intrinsics
+Arena *frame_arena = nullptr;
+} // namespace
+
+Arena::~Arena() {
+    for (Block *b = first_; b;) {
+        auto next = b->next;
+        delete[] reinterpret_cast<char *>(b);
+        b = next;
+    }
+}
+
+void *Arena::allocate_slow(size_t size, size_t align) noexcept {
+    auto data_of = [](Block *b) { return reinterpret_cast<char *>(b + 1); };
+    auto aligned = [align](char *p) {
+        return reinterpret_cast<char *>(
+            (reinterpret_cast<uintptr_t>(p) + align - 1) & ~static_cast<uintptr_t>(align - 1)
+        );
+    };
+    // Blocks kept by a rewind are reused in order
+    Block *next = cur_ ? cur_->next : first_;
+    if (!next || aligned(data_of(next)) + size > data_of(next) + next->size) {
+        size_t bytes = size + align > block_size_ ? size + align : block_size_;
+        auto b       = reinterpret_cast<Block *>(new char[sizeof(Block) + bytes]);
+        if (!b)
+            return nullptr;
+        b->size = bytes;
+        b->next = next;
+        if (cur_)
+            cur_->next = b;
+        else
+            first_ = b;
+        next = b;
+    }
+    cur_ = next;
+    end_ = data_of(cur_) + cur_->size;
+    auto p = aligned(data_of(cur_));
+    ptr_   = p + size;
+    return p;
+}
+
+void Arena::rewind(Mark m) noexcept {
+    cur_ = m.block;
+    ptr_ = m.ptr;
+    end_ = cur_ ? reinterpret_cast<char *>(cur_ + 1) + cur_->size : nullptr;
+}
+
+size_t Arena::capacity() const noexcept {
+    size_t total = 0;
+    for (Block *b = first_; b; b = b->next)
+        total += b->size;
+    return total;
+}
+
+Arena *Arena::current() noexcept { return FrameScope::top_ ? &FrameScope::top_->arena_ : nullptr; }
+
+Arena &Arena::frame() noexcept {
+    if (!frame_arena)
+        frame_arena = new Arena();
+    return *frame_arena;
+}
+
+ArenaUniq<char[]> detail::arena_str(Handle h) noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    auto arena = Arena::current();
+    if (!arena)
+        return ArenaUniq<char[]>(emlite_val_get_value_string(h), true);
+    // The rest of the current block is offered first, so that a string which
+    // fits takes a single crossing, then the unused part is handed back
+    auto m     = arena->mark();
+    size_t cap = arena->available();
+    char *dst  = cap ? arena->allocate_array<char>(cap) : nullptr;
+    size_t len = emlite_val_str_utf8_into(h, dst, cap ? cap - 1 : 0);
+    arena->rewind(m);
+    if (!dst || len >= cap) {
+        dst = arena->allocate_array<char>(len + 1);
+        if (!dst)
+            return ArenaUniq<char[]>();
+        emlite_val_str_utf8_into(h, dst, len);
+    } else {
+        // Same position as before the rewind
+        dst = arena->allocate_array<char>(len + 1);
+    }
+    dst[len] = 0;
+    return ArenaUniq<char[]>(dst, false);
+#else
+    // emlite_val_str_utf8_into is a runtime import, keep the heap copy
+    return ArenaUniq<char[]>(emlite_val_get_value_string(h), true);
+#endif
+}
+} // namespace emlite
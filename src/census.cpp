@@ -0,0 +1,189 @@
+#include <emlite/emlite.hpp>
+
+// Handle census (EMLITE_HANDLE_CENSUS).
+// Every handle a Val takes ownership of is recorded with the innermost
+// HandleSite and a creation number, and its C++ owners are counted like the
+// shadow refcounts do, so that the live handles can be grouped by site.
+
+#ifdef EMLITE_HANDLE_CENSUS
+
+#include "handle_map.hpp"
+
+namespace emlite {
+HandleSite *HandleSite::top_ = nullptr;
+
+namespace {
+struct Record {
+    const char *name;
+    const char *file;
+    int line;
+    uint32_t owners; // 0 once handed over by release_handle
+    uint64_t created;
+};
+
+detail::HandleMap<Record> records;
+uint64_t created = 0;
+// Set while the census reports, so that its own handles aren't recorded
+bool paused = false;
+
+bool ignored(Handle h) noexcept {
+    return paused || h == EMLITE_NULL || h == EMLITE_UNDEFINED || h == EMLITE_GLOBALTHIS ||
+           h == EMLITE_CONSOLE;
+}
+
+void record(detail::HandleMap<Record>::Entry *e) noexcept {
+    auto site = HandleSite::current();
+    e->value  = Record{
+        site ? site->name() : "<untagged>",
+        site ? site->file() : nullptr,
+        site ? site->line() : 0,
+        1,
+        ++created,
+    };
+}
+
+void add_owner(Handle h) noexcept {
+    auto e = records.find(h);
+    if (!e)
+        record(records.insert(h));
+    else if (e->value.owners == 0)
+        // A released handle taken back, or reused by javascript for a new object
+        record(e);
+    else
+        ++e->value.owners;
+}
+
+bool same_site(const HandleSiteCount &c, const Record &r) noexcept {
+    return c.name == r.name && c.file == r.file && c.line == r.line;
+}
+} // namespace
+
+namespace detail {
+void census_adopt(Handle h) noexcept {
+    if (!ignored(h))
+        add_owner(h);
+}
+
+void census_retain(Handle h) noexcept {
+    if (!ignored(h))
+        add_owner(h);
+}
+
+void census_release(Handle h) noexcept {
+    if (ignored(h))
+        return;
+    auto e = records.find(h);
+    if (e && e->value.owners && --e->value.owners == 0)
+        records.erase(e);
+}
+
+void census_disown(Handle h) noexcept {
+    if (ignored(h))
+        return;
+    // The record is kept with no owners, as javascript might never drop it
+    auto e = records.find(h);
+    if (e && e->value.owners)
+        --e->value.owners;
+}
+
+void census_returned(Handle h) noexcept {
+    if (ignored(h))
+        return;
+    // Javascript drops the return value of a callback right after the call,
+    // so a disowned return value isn't kept as released
+    auto e = records.find(h);
+    if (e && e->value.owners == 0)
+        records.erase(e);
+}
+} // namespace detail
+
+HandleSnapshot snapshot_handles() noexcept {
+    size_t live = 0;
+    records.for_each([&](const auto &e) { live += e.value.owners != 0; });
+    return HandleSnapshot{created, live};
+}
+
+Uniq<HandleSiteCount[]> live_handle_sites(size_t &len, HandleSnapshot since) {
+    // Sites are few, so they are grouped by a linear search
+    auto sites = new HandleSiteCount[records.size() ? records.size() : 1];
+    len        = 0;
+    records.for_each([&](const auto &e) {
+        const Record &r = e.value;
+        if (r.created <= since.created)
+            return;
+        size_t i = 0;
+        while (i < len && !same_site(sites[i], r))
+            ++i;
+        if (i == len)
+            sites[len++] = HandleSiteCount{r.name, r.file, r.line, 0, 0, 0};
+        auto &s = sites[i];
+        if (r.owners)
+            ++s.live;
+        else
+            ++s.released;
+        auto age = created - r.created;
+        if (age > s.oldest_age)
+            s.oldest_age = age;
+    });
+    // Insertion sort by decreasing live handles
+    for (size_t i = 1; i < len; ++i) {
+        auto s   = sites[i];
+        size_t j = i;
+        for (; j > 0 && sites[j - 1].live < s.live; --j)
+            sites[j] = sites[j - 1];
+        sites[j] = s;
+    }
+    return Uniq<HandleSiteCount[]>(sites);
+}
+
+void dump_live_handles(HandleSnapshot since) {
+    size_t len = 0;
+    auto sites = live_handle_sites(len, since);
+    auto now   = snapshot_handles();
+
+    paused = true;
+    {
+        auto rows = Val::array();
+        for (size_t i = 0; i < len; ++i) {
+            const auto &s = sites[i];
+            auto row      = Val::object();
+            row.set("site", s.name);
+            if (s.file) {
+                row.set("file", s.file);
+                row.set("line", s.line);
+            }
+            row.set("live", static_cast<double>(s.live));
+            row.set("released", static_cast<double>(s.released));
+            row.set("oldest age", static_cast<double>(s.oldest_age));
+            rows.call("push", row);
+        }
+        Console console;
+        if (since.created) {
+            auto delta = static_cast<double>(now.live) - static_cast<double>(since.live);
+            console.log(
+                Val("emlite: live handles:"), Val(static_cast<double>(now.live)),
+                Val("change since snapshot:"), Val(delta)
+            );
+        } else {
+            console.log(Val("emlite: live handles:"), Val(static_cast<double>(now.live)));
+        }
+        console.call("table", rows);
+    }
+    paused = false;
+}
+} // namespace emlite
+
+#else
+
+namespace emlite {
+HandleSnapshot snapshot_handles() noexcept { return HandleSnapshot{}; }
+
+Uniq<HandleSiteCount[]> live_handle_sites(size_t &len, HandleSnapshot) {
+    len = 0;
+    return Uniq<HandleSiteCount[]>();
+}
+
+void dump_live_handles(HandleSnapshot) {}
+} // namespace emlite
+
+#endif
@@ -0,0 +1,168 @@
+#include <emlite/command_buffer.hpp>
+
+namespace emlite {
+namespace {
+// Identifies the javascript-side slots of each buffer
+uint32_t next_buffer_id = 1;
+
+constexpr size_t initial_words = 1024;
+} // namespace
+
+CommandBuffer::CommandBuffer() noexcept : id_(next_buffer_id++) {}
+
+CommandBuffer::~CommandBuffer() {
+    delete[] words_;
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    detail::emlite_cmd_release(id_);
+#endif
+}
+
+void CommandBuffer::grow(size_t n) {
+    size_t cap = cap_ ? cap_ * 2 : initial_words;
+    while (cap < len_ + n)
+        cap *= 2;
+    auto words = new uint32_t[cap];
+    for (size_t i = 0; i < len_; ++i)
+        words[i] = words_[i];
+    delete[] words_;
+    words_ = words;
+    cap_   = cap;
+}
+
+void CommandBuffer::push_str(const char *s, size_t len) {
+    size_t n = (len + 3) / 4;
+    if (len_ + 2 + n > cap_)
+        grow(2 + n);
+    words_[len_++] = TagString;
+    words_[len_++] = static_cast<uint32_t>(len);
+    // Pad the last word with zeros so the stream stays deterministic
+    if (n)
+        words_[len_ + n - 1] = 0;
+    auto dst = reinterpret_cast<char *>(words_ + len_);
+    for (size_t i = 0; i < len; ++i)
+        dst[i] = s[i];
+    len_ += n;
+}
+
+void CommandBuffer::push_double(double d) {
+    uint32_t w[2];
+    auto src = reinterpret_cast<const char *>(&d);
+    auto dst = reinterpret_cast<char *>(w);
+    for (size_t i = 0; i < sizeof(d); ++i)
+        dst[i] = src[i];
+    push(TagDouble);
+    push(w[0]);
+    push(w[1]);
+}
+
+void CommandBuffer::flush() {
+    // Cleared before the crossing: a javascript exception thrown by a command
+    // unwinds past this frame, and the commands must not be replayed again
+    size_t len = len_;
+    len_       = 0;
+    next_slot_ = 0;
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    detail::emlite_cmd_flush(id_, words_, len);
+#else
+    replay(words_, len);
+#endif
+}
+
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+Val CommandBuffer::get(Ref r) const noexcept {
+    return Val::take_ownership(detail::emlite_cmd_get(id_, r.slot_));
+}
+#else
+Val CommandBuffer::get(Ref r) const noexcept { return slots_.to_val().get(r.slot_); }
+
+// Mirrors emlite_cmd_flush in scripts/index.js
+void CommandBuffer::replay(const uint32_t *words, size_t len) {
+    auto slots = Val::array();
+    slots_     = OwnedVal(slots);
+    size_t i   = 0;
+    auto str   = [&] {
+        size_t n = words[i++];
+        StrView s(reinterpret_cast<const char *>(words + i), n);
+        i += (n + 3) / 4;
+        return s;
+    };
+    auto value = [&]() -> Val {
+        switch (words[i++]) {
+        case TagUndefined:
+            return Val::undefined();
+        case TagNull:
+            return Val::null();
+        case TagFalse:
+            return Val(false);
+        case TagTrue:
+            return Val(true);
+        case TagInt:
+            return Val(static_cast<int32_t>(words[i++]));
+        case TagDouble: {
+            double d;
+            auto src = reinterpret_cast<const char *>(words + i);
+            auto dst = reinterpret_cast<char *>(&d);
+            for (size_t b = 0; b < sizeof(d); ++b)
+                dst[b] = src[b];
+            i += 2;
+            return Val(d);
+        }
+        case TagString:
+            return Val(str());
+        case TagHandle:
+            return Val::dup(words[i++]);
+        case TagSlot:
+            return slots.get(words[i++]);
+        default:
+            return Val::undefined();
+        }
+    };
+    while (i < len) {
+        switch (words[i++]) {
+        case OpCreateElement: {
+            auto slot = words[i++];
+            i++; // string tag
+            slots.set(slot, Val::global("document").call("createElement", Val(str())));
+            break;
+        }
+        case OpSet: {
+            auto target = value();
+            auto key    = value();
+            target.set(key, value());
+            break;
+        }
+        case OpCall: {
+            auto slot   = words[i++];
+            auto target = value();
+            i++; // string tag
+            auto method = str();
+            auto args   = Val::array();
+            for (uint32_t n = words[i++]; n; --n)
+                detail::emlite_val_push(args.as_handle(), value().as_handle());
+            slots.set(
+                slot,
+                Val::take_ownership(detail::emlite_val_obj_call(
+                    target.as_handle(), method.ptr, method.len, args.as_handle()
+                ))
+            );
+            break;
+        }
+        case OpAppendChild: {
+            auto parent = value();
+            parent.call("appendChild", value());
+            break;
+        }
+        case OpSetAttribute: {
+            auto target = value();
+            i++; // string tag
+            auto name = str();
+            target.call("setAttribute", Val(name), value());
+            break;
+        }
+        default:
+            return;
+        }
+    }
+}
+#endif
+} // namespace emlite
@@ -4,53 +4,176 @@
 
 #if __has_include(<new>)
 #else
-void *operator new(size_t size) { return emlite_malloc(size); }
+#ifdef EMLITE_USE_SLAB
+#include <emlite/slab.hpp>
+#define EMLITE_ALLOC(size) emlite::slab_malloc(size)
+#define EMLITE_FREE(ptr) emlite::slab_free(ptr)
+#else
+#define EMLITE_ALLOC(size) emlite_malloc(size)
+#define EMLITE_FREE(ptr) emlite_free(ptr)
+#endif
+
+void *operator new(size_t size) { return EMLITE_ALLOC(size); }
 
-void *operator new[](size_t size) { return emlite_malloc(size); }
+void *operator new[](size_t size) { return EMLITE_ALLOC(size); }
 
-void operator delete(void *val) noexcept { emlite_free(val); }
+void operator delete(void *val) noexcept { EMLITE_FREE(val); }
 
 void operator delete(void *ptr, size_t) noexcept {
-  emlite_free(ptr);
+  EMLITE_FREE(ptr);
 }
 
 void operator delete[](void *ptr, size_t) noexcept {
-  emlite_free(ptr);
+  EMLITE_FREE(ptr);
 }
 
-void operator delete[](void *val) noexcept { emlite_free(val); }
+void operator delete[](void *val) noexcept { EMLITE_FREE(val); }
 
 void *operator new(size_t, void *place) noexcept { return place; }
 #endif
 namespace emlite {
+namespace {
+// Indexed by Intrinsic
+const char *const intrinsic_names[] = {
+    "Function",
+    "Error",
+    "Array",
+    "Object",
+    "Promise",
+    "String",
+    "Number",
+    "Symbol",
+    "Reflect",
+    "JSON",
+    "ArrayBuffer",
+    "Int8Array",
+    "Uint8Array",
+    "Int16Array",
+    "Uint16Array",
+    "Int32Array",
+    "Uint32Array",
+    "Float32Array",
+    "Float64Array",
+    "BigInt64Array",
+    "BigUint64Array",
+};
+static_assert(
+    sizeof(intrinsic_names) / sizeof(intrinsic_names[0]) == static_cast<size_t>(Intrinsic::Count),
+    "intrinsic_names must match Intrinsic"
+);
+
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+// The longest strings which detail::make_str passes to emlite_val_make_str_ascii
+constexpr size_t short_ascii_max = 12;
+
+// Whether the `len` bytes at s are all ASCII
+bool is_ascii(const char *s, size_t len) noexcept {
+    unsigned char acc = 0;
+    for (size_t i = 0; i < len; ++i)
+        acc |= static_cast<unsigned char>(s[i]);
+    return acc < 0x80;
+}
+
+// Callbacks created by make_fn(Closure) receive at most this many arguments
+constexpr size_t callback_slot_size = 16;
+Handle callback_slot[callback_slot_size];
+
+/// A pool of fixed-size blocks for the closures owned by javascript functions.
+/// Freed blocks are kept in a free list and reused, so creating and dropping
+/// callbacks doesn't grow memory beyond the peak number of live closures.
+class ClosurePool {
+    union Block {
+        Block *next;
+        alignas(Closure<Val(Params)>) unsigned char storage[sizeof(Closure<Val(Params)>)];
+    };
+    static constexpr size_t chunk_size = 64;
+    Block *free_                       = nullptr;
+
+    void grow() {
+        auto chunk = new Block[chunk_size];
+        for (size_t i = 0; i < chunk_size; ++i) {
+            chunk[i].next = free_;
+            free_         = &chunk[i];
+        }
+    }
+
+  public:
+    void *allocate() {
+        if (!free_)
+            grow();
+        auto b = free_;
+        free_  = b->next;
+        return b;
+    }
+
+    void deallocate(void *p) noexcept {
+        auto b  = static_cast<Block *>(p);
+        b->next = free_;
+        free_   = b;
+    }
+};
+
+ClosurePool closure_pool;
+#endif
+} // namespace
+
+Val *Val::intrinsics_ = nullptr;
+
 void init() {
     #ifndef EMSCRIPTEN
     // check(emlite_target() == EMLITE_TARGET);
     #endif
     emlite_init_handle_table();
+    Val::init_intrinsics();
+}
+
+void Val::init_intrinsics() noexcept {
+    // Never freed, the handles stay pinned for the lifetime of the program
+    if (!intrinsics_)
+        intrinsics_ = new Val[static_cast<size_t>(Intrinsic::Count)];
+    for (size_t i = 0; i < static_cast<size_t>(Intrinsic::Count); ++i)
+        intrinsics_[i] = Val::global(intrinsic_names[i]);
+}
+
+const Val &Val::intrinsic(Intrinsic which) noexcept {
+    return intrinsics_[static_cast<size_t>(which)];
 }
 
+Handle detail::make_str(const char *s, size_t len) noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    // Short ASCII strings are built on the js side without a TextDecoder call,
+    // which only pays off below 16 bytes, so longer strings aren't scanned
+    if (len <= short_ascii_max && is_ascii(s, len))
+        return emlite_val_make_str_ascii(s, len);
+#endif
+    return emlite_val_make_str(s, len);
+}
+
+Atom::Atom(const char *name) noexcept : h_(detail::make_str(name, strlen(name))) {}
+
+Atom::Atom(const char *name, size_t len) noexcept : h_(detail::make_str(name, len)) {}
+
 Val::Val() noexcept : v_(0) {}
 
 Val::Val(const Val &other) noexcept : v_(other.v_) {
     if (v_)
-        emlite_val_inc_ref(v_);
+        detail::handle_retain(v_);
 }
 Val &Val::operator=(const Val &other) noexcept {
     if (this == &other)
         return *this;
     if (v_)
-        emlite_val_dec_ref(v_);
+        detail::handle_release(v_);
     v_ = other.v_;
     if (v_)
-        emlite_val_inc_ref(v_);
+        detail::handle_retain(v_);
     return *this;
 }
 
 Val &Val::operator=(Val &&other) noexcept {
     if (this != &other) {
         if (v_)
-            emlite_val_dec_ref(v_);
+            detail::handle_release(v_);
         v_       = other.v_;
         other.v_ = 0;
     }
@@ -61,7 +184,7 @@ Val::Val(Val &&other) noexcept : v_(other.v_) { other.v_ = 0; }
 
 Val::~Val() {
     if (v_)
-        emlite_val_dec_ref(v_);
+        detail::handle_release(v_);
 }
 
 Val Val::clone() const noexcept { return *this; }
@@ -69,6 +192,7 @@ Val Val::clone() const noexcept { return *this; }
 Val Val::take_ownership(Handle h) noexcept {
     Val v;
     v.v_ = h;
+    detail::handle_adopt(h);
     return v;
 }
 
@@ -80,50 +204,65 @@ Val Val::null() noexcept { return Val::take_ownership(EMLITE_NULL); }
 
 Val Val::undefined() noexcept { return Val::take_ownership(EMLITE_UNDEFINED); }
 
-Val Val::object() noexcept { return Val::take_ownership(emlite_val_new_object()); }
+Val Val::object() noexcept { return Val::take_ownership(detail::emlite_val_new_object()); }
 
-Val Val::array() noexcept { return Val::take_ownership(emlite_val_new_array()); }
+Val Val::array() noexcept { return Val::take_ownership(detail::emlite_val_new_array()); }
 
 Val Val::dup(Handle h) noexcept {
-    emlite_val_inc_ref(h);
-    return Val::take_ownership(h);
+    Val v;
+    v.v_ = h;
+    detail::handle_retain(h);
+    return v;
 }
 
 Handle Val::release_handle() noexcept {
     auto temp = this->v_;
     this->v_     = 0;
+    detail::handle_disown(temp);
     return temp;
 }
 
-void Val::delete_(Val &&v) noexcept { emlite_val_dec_ref(detail::move(v).v_); }
+void Val::delete_(Val &&v) noexcept {
+    auto h = v.v_;
+    v.v_   = 0;
+    if (h)
+        detail::handle_release(h);
+}
 
-void Val::throw_(const Val &v) { return emlite_val_throw(v.v_); }
+void Val::throw_(ValRef v) { return detail::emlite_val_throw(v.as_handle()); }
 
 Handle Val::as_handle() const noexcept { return v_; }
 
-Uniq<char[]> Val::type_of() const noexcept { return Uniq<char[]>(emlite_val_typeof(v_)); }
+Uniq<char[]> Val::type_of() const noexcept { return Uniq<char[]>(detail::emlite_val_typeof(v_)); }
 
 bool Val::has_own_property(const char *prop) const noexcept {
-    return emlite_val_obj_has_own_prop(v_, prop, strlen(prop));
+    return detail::emlite_val_obj_has_own_prop(v_, prop, strlen(prop));
+}
+
+bool Val::has_own_property(StrView prop) const noexcept {
+    return detail::emlite_val_obj_has_own_prop(v_, prop.ptr, prop.len);
 }
 
 Val Val::make_fn(Callback f, Val data) noexcept {
 #ifdef EMLITE_WASIP2_COMPONENT
     // JS-side callback storage for all targets: pack function pointer + user data
-    if (data.v_) emlite_val_inc_ref(data.v_);
+    if (data.v_) detail::emlite_val_inc_ref(data.v_);
     auto pack = (EmliteCbPack *)emlite_malloc(sizeof(EmliteCbPack));
     if (!pack) return Val::undefined();
     pack->fn = f;
     pack->user_data = data.v_;
-    Handle packed = emlite_val_make_biguint((uint64_t)(uintptr_t)pack);
-    return Val::take_ownership(emlite_val_make_callback(0, packed));
+    Handle packed = detail::emlite_val_make_biguint((uint64_t)(uintptr_t)pack);
+    return Val::take_ownership(detail::emlite_val_make_callback(0, packed));
 #else
     Handle fidx = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(f));
-    return Val::take_ownership(emlite_val_make_callback(fidx, data.release_handle()));
+    return Val::take_ownership(detail::emlite_val_make_callback(fidx, data.release_handle()));
 #endif
 }
 
 Val Val::make_fn(Closure<Val(Params)> &&f) noexcept {
+#if !EMLITE_HAVE_RUNTIME_IMPORTS
+    // Without emlite_val_make_closure, the closure goes through a plain
+    // callback and is never freed
     return Val::make_fn(
         [](auto h, auto data) -> Handle {
             Val func0  = Val::take_ownership(data);
@@ -137,49 +276,277 @@ Val Val::make_fn(Closure<Val(Params)> &&f) noexcept {
         },
         Val((uintptr_t) new Closure<Val(Params)>(detail::move(f)))
     );
+#else
+    // The js side writes the argument handles into callback_slot, then calls
+    // the trampoline through the function table with the closure pointer.
+    Handle (*trampoline)(void *, const Handle *, size_t) =
+        [](void *data, const Handle *argv, size_t argc) -> Handle {
+        auto func = static_cast<Closure<Val(Params)> *>(data);
+        Handle ret;
+        {
+            // Take the handles out of the shared slot before running user code,
+            // since a nested callback would overwrite it
+            Val vals[callback_slot_size];
+            for (size_t i = 0; i < argc; ++i)
+                vals[i] = Val::take_ownership(argv[i]);
+            ret = (*func)(Params{vals, argc}).release_handle();
+            detail::census_returned(ret);
+        }
+        emlite::flush();
+        return ret;
+    };
+    // Called by javascript on dispose_fn, or once the function is garbage collected
+    void (*drop)(void *) = [](void *data) {
+        auto func = static_cast<Closure<Val(Params)> *>(data);
+        func->~Closure();
+        closure_pool.deallocate(func);
+    };
+    Handle fidx    = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(trampoline));
+    Handle dropidx = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(drop));
+    auto func      = new (closure_pool.allocate()) Closure<Val(Params)>(detail::move(f));
+    return Val::take_ownership(
+        detail::emlite_val_make_closure(fidx, dropidx, func, callback_slot, callback_slot_size)
+    );
+#endif
+}
+
+void Val::dispose_fn(const Val &fn) noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    detail::emlite_val_dispose_closure(fn.v_);
+#else
+    (void)fn;
+#endif
 }
 
-// clang-format off
 Val Val::await() const {
-    return emlite_eval_cpp(
-        "(async() => { let obj = EMLITE_VALMAP.toValue(%d); let ret = await obj; "
-        "return EMLITE_VALMAP.toHandle(ret); })()",
-        v_
-    );
+    // The async wrapper formerly eval'd here resolved to a handle number, leaking
+    // the handle, this one resolves to the value
+    return Val::intrinsic(Intrinsic::Promise).call(EMLITE_ATOM("resolve"), ValRef(v_));
 }
-// clang-format on
 
-bool Val::is_bool() const noexcept { return emlite_val_is_bool(v_); }
+bool Val::is_bool() const noexcept { return detail::emlite_val_is_bool(v_); }
 
-bool Val::is_number() const noexcept { return emlite_val_is_number(v_); }
+bool Val::is_number() const noexcept { return detail::emlite_val_is_number(v_); }
 
-bool Val::is_string() const noexcept { return emlite_val_is_string(v_); }
+bool Val::is_string() const noexcept { return detail::emlite_val_is_string(v_); }
 
-bool Val:: instanceof (const Val &v) const noexcept { return emlite_val_instanceof(v_, v.v_); }
+bool Val:: instanceof (ValRef v) const noexcept { return detail::emlite_val_instanceof(v_, v.as_handle()); }
 
-bool Val::is_function() const noexcept { return instanceof (Val::global("Function")); }
+bool Val::is_function() const noexcept { return instanceof (Val::intrinsic(Intrinsic::Function)); }
 
-bool Val::is_error() const noexcept { return instanceof (Val::global("Error")); }
+bool Val::is_error() const noexcept { return instanceof (Val::intrinsic(Intrinsic::Error)); }
+
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+Kind Val::kind() const noexcept { return static_cast<Kind>(detail::emlite_val_kind(v_)); }
+
+bool Val::has_kind(Kind k) const noexcept { return kind() == k; }
+#else
+Kind Val::kind() const noexcept {
+    // The checks emlite_val_kind makes in one crossing, one at a time
+    if (is_undefined())
+        return Kind::Undefined;
+    if (is_null())
+        return Kind::Null;
+    if (is_bool())
+        return Kind::Bool;
+    if (is_number())
+        return Kind::Number;
+    if (is_string())
+        return Kind::String;
+    // bigint, symbol, function or object: booleans and strings are already handled
+    switch (type_of()[0]) {
+    case 'b':
+        return Kind::BigInt;
+    case 's':
+        return Kind::Symbol;
+    case 'f':
+        return Kind::Function;
+    default:
+        break;
+    }
+    if (Val::intrinsic(Intrinsic::Array).call("isArray", ValRef(v_)).as<bool>())
+        return Kind::Array;
+    // %TypedArray%, the prototype of the TypedArray constructors
+    static const Val typed_array =
+        Val::intrinsic(Intrinsic::Object)
+            .call("getPrototypeOf", Val::intrinsic(Intrinsic::Int8Array));
+    if (instanceof (typed_array))
+        return Kind::TypedArray;
+    if (is_error())
+        return Kind::Error;
+    return Kind::Object;
+}
+
+bool Val::has_kind(Kind k) const noexcept {
+    switch (k) {
+    case Kind::Undefined:
+        return is_undefined();
+    case Kind::Null:
+        return is_null();
+    case Kind::Bool:
+        return is_bool();
+    case Kind::Number:
+        return is_number();
+    case Kind::String:
+        return is_string();
+    case Kind::Error:
+        return is_error();
+    default:
+        return kind() == k;
+    }
+}
+#endif
 
 bool Val::is_undefined() const noexcept { return v_ == EMLITE_UNDEFINED; }
 
 bool Val::is_null() const noexcept { return v_ == EMLITE_NULL; }
 
-bool Val::operator!() const { return emlite_val_not(v_); }
+bool Val::operator!() const { return detail::emlite_val_not(v_); }
 
-bool Val::operator==(const Val &other) const { return emlite_val_strictly_equals(v_, other.v_); }
+bool Val::operator==(ValRef other) const {
+    return detail::emlite_val_strictly_equals(v_, other.as_handle());
+}
 
-bool Val::operator!=(const Val &other) const { return !emlite_val_strictly_equals(v_, other.v_); }
+bool Val::operator!=(ValRef other) const {
+    return !detail::emlite_val_strictly_equals(v_, other.as_handle());
+}
 
-bool Val::operator>(const Val &other) const { return emlite_val_gt(v_, other.v_); }
+bool Val::operator>(ValRef other) const { return detail::emlite_val_gt(v_, other.as_handle()); }
 
-bool Val::operator>=(const Val &other) const { return emlite_val_gte(v_, other.v_); }
+bool Val::operator>=(ValRef other) const { return detail::emlite_val_gte(v_, other.as_handle()); }
 
-bool Val::operator<(const Val &other) const { return emlite_val_lt(v_, other.v_); }
+bool Val::operator<(ValRef other) const { return detail::emlite_val_lt(v_, other.as_handle()); }
 
-bool Val::operator<=(const Val &other) const { return emlite_val_lte(v_, other.v_); }
+bool Val::operator<=(ValRef other) const { return detail::emlite_val_lte(v_, other.as_handle()); }
 
 Console::Console() : Val(Val::take_ownership(EMLITE_CONSOLE)) {}
 
 void Console::clear() const { call("clear"); }
+
+#if !EMLITE_HAVE_RUNTIME_IMPORTS
+namespace detail {
+namespace {
+template <typename F>
+F &field_at(void *p, const Field &f) noexcept {
+    return *reinterpret_cast<F *>(static_cast<char *>(p) + f.offset);
+}
+
+template <typename F>
+const F &field_at(const void *p, const Field &f) noexcept {
+    return *reinterpret_cast<const F *>(static_cast<const char *>(p) + f.offset);
+}
+
+// The conversions of the shape compiler of scripts/index.js
+Val field_value(const void *p, const Field &f) noexcept {
+    switch (f.kind) {
+    case FieldKind::I8:
+        return Val(field_at<int8_t>(p, f));
+    case FieldKind::U8:
+        return Val(field_at<uint8_t>(p, f));
+    case FieldKind::I16:
+        return Val(field_at<int16_t>(p, f));
+    case FieldKind::U16:
+        return Val(field_at<uint16_t>(p, f));
+    case FieldKind::I32:
+        return Val(field_at<int32_t>(p, f));
+    case FieldKind::U32:
+        return Val(field_at<uint32_t>(p, f));
+    case FieldKind::I64:
+        return Val(field_at<int64_t>(p, f));
+    case FieldKind::U64:
+        return Val(field_at<uint64_t>(p, f));
+    case FieldKind::F32:
+        return Val(field_at<float>(p, f));
+    case FieldKind::F64:
+        return Val(field_at<double>(p, f));
+    case FieldKind::Bool:
+        return Val(field_at<bool>(p, f));
+    case FieldKind::CStr: {
+        auto s = field_at<const char *>(p, f);
+        return s ? Val(s) : Val::null();
+    }
+    case FieldKind::StrView:
+        return Val(field_at<StrView>(p, f));
+    }
+    return Val::undefined();
+}
+
+// Strings are only converted to javascript
+void read_field(void *p, const Field &f, const Val &v) noexcept {
+    switch (f.kind) {
+    case FieldKind::I8:
+        field_at<int8_t>(p, f) = v.as<int8_t>();
+        break;
+    case FieldKind::U8:
+        field_at<uint8_t>(p, f) = v.as<uint8_t>();
+        break;
+    case FieldKind::I16:
+        field_at<int16_t>(p, f) = v.as<int16_t>();
+        break;
+    case FieldKind::U16:
+        field_at<uint16_t>(p, f) = v.as<uint16_t>();
+        break;
+    case FieldKind::I32:
+        field_at<int32_t>(p, f) = v.as<int32_t>();
+        break;
+    case FieldKind::U32:
+        field_at<uint32_t>(p, f) = v.as<uint32_t>();
+        break;
+    case FieldKind::I64:
+        field_at<int64_t>(p, f) = v.as<int64_t>();
+        break;
+    case FieldKind::U64:
+        field_at<uint64_t>(p, f) = v.as<uint64_t>();
+        break;
+    case FieldKind::F32:
+        field_at<float>(p, f) = v.as<float>();
+        break;
+    case FieldKind::F64:
+        field_at<double>(p, f) = v.as<double>();
+        break;
+    case FieldKind::Bool:
+        field_at<bool>(p, f) = !!v;
+        break;
+    case FieldKind::CStr:
+    case FieldKind::StrView:
+        break;
+    }
+}
+} // namespace
+
+Handle make_fields(const Shape &s, const void *ptr) noexcept {
+    auto obj = Val::object();
+    for (uint32_t i = 0; i < s.count; ++i)
+        obj.set(s.fields[i].name, field_value(ptr, s.fields[i]));
+    return obj.release_handle();
+}
+
+void read_fields(const Shape &s, Handle obj, void *ptr) noexcept {
+    if (obj == EMLITE_NULL || obj == EMLITE_UNDEFINED)
+        return;
+    auto o = Val::dup(obj);
+    for (uint32_t i = 0; i < s.count; ++i)
+        read_field(ptr, s.fields[i], o.get(s.fields[i].name));
+}
+
+Handle make_fields_array(const Shape &s, const void *ptr, size_t n) noexcept {
+    auto arr = Val::array();
+    auto p   = static_cast<const char *>(ptr);
+    for (size_t i = 0; i < n; ++i, p += s.size)
+        arr.set(static_cast<uint32_t>(i), Val::take_ownership(make_fields(s, p)));
+    return arr.release_handle();
+}
+
+size_t read_fields_array(const Shape &s, Handle arr, void *ptr, size_t cap) noexcept {
+    auto a = Val::dup(arr);
+    auto n = a.get("length").as<size_t>();
+    if (n > cap)
+        n = cap;
+    auto p = static_cast<char *>(ptr);
+    for (size_t i = 0; i < n; ++i, p += s.size)
+        read_fields(s, a[i].as_handle(), p);
+    return n;
+}
+} // namespace detail
+#endif
 } // namespace emlite
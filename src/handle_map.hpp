@@ -0,0 +1,98 @@
+#pragma once
+
+#include <emlite/emlite.hpp>
+
+// Internal to the library: a hash map keyed by handles, shared by the shadow
+// refcounts (src/refcount.cpp) and the handle census (src/census.cpp).
+
+namespace emlite {
+namespace detail {
+/// An open-addressing hash map with linear probing, from live handles to V.
+/// The handle 0 marks an empty slot.
+template <typename V>
+class HandleMap {
+  public:
+    struct Entry {
+        Handle h;
+        V value;
+    };
+
+  private:
+    Entry *slots_ = nullptr;
+    size_t cap_   = 0; // a power of two
+    size_t len_   = 0;
+
+    static size_t hash(Handle h) noexcept { return static_cast<uint32_t>(h) * 2654435761u; }
+
+    void grow() {
+        auto old     = slots_;
+        auto old_cap = cap_;
+        cap_         = cap_ ? cap_ * 2 : 256;
+        slots_       = new Entry[cap_]();
+        len_         = 0;
+        for (size_t i = 0; i < old_cap; ++i) {
+            if (old[i].h)
+                insert(old[i].h)->value = old[i].value;
+        }
+        delete[] old;
+    }
+
+  public:
+    Entry *find(Handle h) noexcept {
+        if (!cap_)
+            return nullptr;
+        size_t mask = cap_ - 1;
+        for (size_t i = hash(h) & mask;; i = (i + 1) & mask) {
+            if (slots_[i].h == h)
+                return &slots_[i];
+            if (!slots_[i].h)
+                return nullptr;
+        }
+    }
+
+    /// Inserts a handle which isn't in the map yet, with a value-initialized V
+    Entry *insert(Handle h) {
+        if ((len_ + 1) * 2 > cap_)
+            grow();
+        size_t mask = cap_ - 1;
+        size_t i    = hash(h) & mask;
+        while (slots_[i].h)
+            i = (i + 1) & mask;
+        slots_[i] = Entry{h, V{}};
+        ++len_;
+        return &slots_[i];
+    }
+
+    /// Removes an entry, shifting back the entries of its probe sequence
+    void erase(Entry *e) noexcept {
+        size_t mask = cap_ - 1;
+        size_t i    = static_cast<size_t>(e - slots_);
+        size_t j    = i;
+        for (;;) {
+            j = (j + 1) & mask;
+            if (!slots_[j].h)
+                break;
+            size_t k = hash(slots_[j].h) & mask;
+            // the entry at j stays if its home slot lies cyclically in (i, j]
+            if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+                continue;
+            slots_[i] = slots_[j];
+            i         = j;
+        }
+        slots_[i] = Entry{0, V{}};
+        --len_;
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return len_; }
+
+    /// Calls f on every entry
+    template <typename F>
+    void for_each(F &&f) const {
+        for (size_t i = 0; i < cap_; ++i) {
+            if (slots_[i].h)
+                f(slots_[i]);
+        }
+    }
+};
+} // namespace detail
+} // namespace emlite
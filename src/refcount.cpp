@@ -0,0 +1,171 @@
+#include <emlite/emlite.hpp>
+
+#include "handle_map.hpp"
+
+namespace emlite {
+namespace {
+/// Releases `n` handles, in a single crossing with the runtime imports
+void release_batch(const Handle *ptr, size_t n) noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    detail::emlite_val_dec_ref_batch(ptr, n);
+#else
+    for (size_t i = 0; i < n; ++i)
+        detail::emlite_val_dec_ref(ptr[i]);
+#endif
+}
+} // namespace
+
+HandleScope *HandleScope::top_ = nullptr;
+
+HandleScope::HandleScope() noexcept
+    : prev_(top_), buf_(inline_), len_(0), cap_(inline_size) {
+    top_ = this;
+}
+
+HandleScope::~HandleScope() {
+    flush();
+    if (buf_ != inline_)
+        delete[] buf_;
+    top_ = prev_;
+#ifdef EMLITE_SHADOW_REFCOUNT
+    emlite::flush();
+#endif
+}
+
+void HandleScope::flush() noexcept {
+    if (!len_)
+        return;
+    auto len = len_;
+    len_     = 0;
+    release_batch(buf_, len);
+}
+
+void HandleScope::defer(Handle h) noexcept {
+    if (len_ == cap_) {
+        auto buf = new Handle[cap_ * 2];
+        for (size_t i = 0; i < len_; ++i)
+            buf[i] = buf_[i];
+        if (buf_ != inline_)
+            delete[] buf_;
+        buf_ = buf;
+        cap_ *= 2;
+    }
+    buf_[len_++] = h;
+}
+} // namespace emlite
+
+// Shadow refcounts (EMLITE_SHADOW_REFCOUNT).
+// Every handle owned on the C++ side holds exactly one javascript reference,
+// while the number of its C++ owners is tracked in a table in linear memory.
+// Copies and destructions only update that table. Handles whose count drops
+// to zero are queued, and the queue is released to javascript in a single
+// crossing when it fills up, on emlite::flush(), or at the end of a callback.
+
+#ifdef EMLITE_SHADOW_REFCOUNT
+
+#ifndef EMLITE_RELEASE_QUEUE_SIZE
+#define EMLITE_RELEASE_QUEUE_SIZE 256
+#endif
+
+namespace emlite {
+namespace {
+/// Maps live handles to the number of their C++ owners
+detail::HandleMap<uint32_t> shadow_table;
+Handle release_queue[EMLITE_RELEASE_QUEUE_SIZE];
+size_t release_len = 0;
+
+void enqueue_release(Handle h) noexcept {
+    release_queue[release_len++] = h;
+    if (release_len == EMLITE_RELEASE_QUEUE_SIZE)
+        flush();
+}
+} // namespace
+
+void flush() {
+    if (!release_len)
+        return;
+    auto len    = release_len;
+    release_len = 0;
+    release_batch(release_queue, len);
+}
+
+namespace detail {
+void handle_adopt(Handle h) noexcept {
+    if (!h)
+        return;
+    stats_handle_acquired(h, true);
+    census_adopt(h);
+    if (auto e = shadow_table.find(h)) {
+        // The entry already holds a javascript reference, drop the new one
+        ++e->value;
+        enqueue_release(h);
+    } else {
+        shadow_table.insert(h)->value = 1;
+    }
+}
+
+void handle_retain(Handle h) noexcept {
+    if (!h)
+        return;
+    stats_handle_acquired(h, false);
+    census_retain(h);
+    if (auto e = shadow_table.find(h)) {
+        ++e->value;
+    } else {
+        emlite_val_inc_ref(h);
+        shadow_table.insert(h)->value = 1;
+    }
+}
+
+void handle_release(Handle h) noexcept {
+    if (!h)
+        return;
+    stats_handle_released(h);
+    census_release(h);
+    auto e = shadow_table.find(h);
+    if (!e) {
+        emlite_val_dec_ref(h);
+        return;
+    }
+    if (--e->value == 0) {
+        shadow_table.erase(e);
+        enqueue_release(h);
+    }
+}
+
+void handle_disown(Handle h) noexcept {
+    if (!h)
+        return;
+    stats_handle_released(h);
+    census_disown(h);
+    auto e = shadow_table.find(h);
+    if (!e)
+        return;
+    if (e->value > 1) {
+        --e->value;
+        emlite_val_inc_ref(h);
+    } else {
+        shadow_table.erase(e);
+    }
+}
+} // namespace detail
+} // namespace emlite
+
+#else
+
+namespace emlite {
+void flush() {}
+
+namespace detail {
+void handle_release(Handle h) noexcept {
+    stats_handle_released(h);
+    census_release(h);
+    if (HandleScope::top_)
+        HandleScope::top_->defer(h);
+    else
+        emlite_val_dec_ref(h);
+}
+} // namespace detail
+} // namespace emlite
+
+#endif
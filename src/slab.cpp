@@ -0,0 +1,314 @@
+#include <emlite/slab.hpp>
+
+// Size-class slab allocator, see include/emlite/slab.hpp.
+//
+// Memory comes from the backend in chunks of whole wasm pages, growing from
+// one page to 16, and is split in slabs aligned to their size. Every block
+// lives in a span of slabs, whose header is at the start of its first slab,
+// so the span of a block is found by masking its address:
+// - a small span is one slab serving blocks of one size class, carved lazily
+//   and recycled through a free list;
+// - a large span is a run of slabs holding a single block;
+// - a huge block, larger than a chunk, is allocated from the backend directly;
+// - free spans are kept sorted by address and coalesced.
+//
+// Blocks allocated by javascript through emlite_malloc (strings returned by the
+// imports) are also freed with operator delete, so spans carry a cookie derived
+// from their address, and blocks without one are handed back to the backend.
+//
+// With EMLITE_SLAB_RECYCLE, the empty slabs of a size class are returned to the
+// free spans, where any class or large block can reuse them, instead of staying
+// reserved to their class.
+
+namespace emlite {
+namespace {
+constexpr size_t slab_size = 16384;
+constexpr size_t wasm_page = 65536;
+constexpr size_t min_chunk = wasm_page;
+constexpr size_t max_chunk = 16 * wasm_page;
+// Larger blocks go straight to the backend
+constexpr size_t max_large_slabs = max_chunk / slab_size / 2;
+
+constexpr uint16_t class_sizes[] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 256, 320, 384, 512, 768, 1024, 1536, 2048,
+};
+constexpr size_t class_count = sizeof(class_sizes) / sizeof(class_sizes[0]);
+constexpr size_t max_small   = 2048;
+
+// Maps (size + 15) / 16 to the smallest class fitting size
+struct ClassTable {
+    uint8_t idx[max_small / 16 + 1];
+};
+
+constexpr ClassTable make_class_table() {
+    ClassTable t{};
+    size_t c = 0;
+    for (size_t i = 0; i <= max_small / 16; ++i) {
+        while (class_sizes[c] < i * 16)
+            ++c;
+        t.idx[i] = static_cast<uint8_t>(c);
+    }
+    return t;
+}
+
+constexpr ClassTable class_table = make_class_table();
+
+// Span kinds besides the size classes
+constexpr uint32_t span_large = 0x100;
+constexpr uint32_t span_huge  = 0x101;
+constexpr uint32_t span_free  = 0x102;
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+struct Span {
+    uint32_t cookie;
+    uint32_t kind;
+    uint32_t slabs; // length of large and free spans
+    uint32_t used;  // blocks in use of small spans
+    size_t size;    // requested size of large and huge blocks
+    FreeBlock *free;
+    char *bump; // never used part of small spans, backend block of huge ones
+    Span *prev;
+    Span *next;
+};
+
+constexpr size_t header_size = (sizeof(Span) + 15) & ~size_t(15);
+
+Span *partial[class_count]; // small spans with room, by class
+Span *free_spans;           // sorted by address
+char *chunk_next;
+size_t chunk_left; // in slabs
+size_t next_chunk = min_chunk;
+SlabStats stats;
+
+uint32_t cookie_of(const Span *s) noexcept {
+    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(s)) ^ 0x51ab5eedu;
+}
+
+char *align_up(char *p, size_t a) noexcept {
+    auto v = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<char *>((v + a - 1) & ~(uintptr_t)(a - 1));
+}
+
+char *end_of(Span *s) noexcept { return reinterpret_cast<char *>(s) + slab_size * s->slabs; }
+
+void push_front(Span *&head, Span *s) noexcept {
+    s->prev = nullptr;
+    s->next = head;
+    if (head)
+        head->prev = s;
+    head = s;
+}
+
+void unlink(Span *&head, Span *s) noexcept {
+    if (s->prev)
+        s->prev->next = s->next;
+    else
+        head = s->next;
+    if (s->next)
+        s->next->prev = s->prev;
+}
+
+/// Adds a run of slabs to the free spans, merging it with its neighbours
+void release(Span *s, size_t slabs) noexcept {
+    s->cookie = 0;
+    s->kind   = span_free;
+    s->slabs  = static_cast<uint32_t>(slabs);
+    stats.free_slabs += slabs * slab_size;
+
+    Span *prev = nullptr;
+    Span *next = free_spans;
+    while (next && next < s) {
+        prev = next;
+        next = next->next;
+    }
+    if (next && end_of(s) == reinterpret_cast<char *>(next)) {
+        s->slabs += next->slabs;
+        next = next->next;
+    }
+    if (prev && end_of(prev) == reinterpret_cast<char *>(s)) {
+        prev->slabs += s->slabs;
+        prev->next = next;
+        if (next)
+            next->prev = prev;
+        return;
+    }
+    s->prev = prev;
+    s->next = next;
+    if (prev)
+        prev->next = s;
+    else
+        free_spans = s;
+    if (next)
+        next->prev = s;
+}
+
+/// Takes a new chunk of whole wasm pages from the backend, fitting `slabs`
+bool refill(size_t slabs) noexcept {
+    size_t bytes = next_chunk;
+    while (bytes < (slabs + 1) * slab_size)
+        bytes += wasm_page;
+    auto p = static_cast<char *>(emlite_malloc(bytes));
+    if (!p)
+        return false;
+    stats.footprint += bytes;
+    if (next_chunk < max_chunk)
+        next_chunk *= 2;
+    // The rest of the current chunk stays available as a free span
+    if (chunk_left)
+        release(reinterpret_cast<Span *>(chunk_next), chunk_left);
+    chunk_next = align_up(p, slab_size);
+    chunk_left = static_cast<size_t>(p + bytes - chunk_next) / slab_size;
+    // Blocks which aren't ours may lie at the start of the unused tail
+    auto tail = chunk_next + chunk_left * slab_size;
+    if (tail + sizeof(uint32_t) <= p + bytes)
+        reinterpret_cast<Span *>(tail)->cookie = 0;
+    return true;
+}
+
+/// @returns a run of `slabs` contiguous slabs
+Span *acquire(size_t slabs) noexcept {
+    for (Span *s = free_spans; s; s = s->next) {
+        if (s->slabs < slabs)
+            continue;
+        if (s->slabs > slabs) {
+            // Split, the rest takes the place of s in the sorted list
+            auto rest = reinterpret_cast<Span *>(reinterpret_cast<char *>(s) + slabs * slab_size);
+            rest->cookie = 0;
+            rest->kind   = span_free;
+            rest->slabs  = static_cast<uint32_t>(s->slabs - slabs);
+            rest->prev   = s->prev;
+            rest->next   = s->next;
+            if (s->prev)
+                s->prev->next = rest;
+            else
+                free_spans = rest;
+            if (s->next)
+                s->next->prev = rest;
+        } else {
+            unlink(free_spans, s);
+        }
+        stats.free_slabs -= slabs * slab_size;
+        return s;
+    }
+    if (chunk_left < slabs && !refill(slabs))
+        return nullptr;
+    auto s = reinterpret_cast<Span *>(chunk_next);
+    chunk_next += slabs * slab_size;
+    chunk_left -= slabs;
+    return s;
+}
+
+bool is_full(const Span *s, size_t block) noexcept {
+    return !s->free && s->bump + block > reinterpret_cast<const char *>(s) + slab_size;
+}
+
+void *small_malloc(size_t c) noexcept {
+    size_t block = class_sizes[c];
+    Span *s      = partial[c];
+    if (!s) {
+        s = acquire(1);
+        if (!s)
+            return nullptr;
+        s->cookie = cookie_of(s);
+        s->kind   = static_cast<uint32_t>(c);
+        s->slabs  = 1;
+        s->used   = 0;
+        s->free   = nullptr;
+        s->bump   = reinterpret_cast<char *>(s) + header_size;
+        push_front(partial[c], s);
+    }
+    void *p;
+    if (s->free) {
+        p       = s->free;
+        s->free = s->free->next;
+    } else {
+        p = s->bump;
+        s->bump += block;
+    }
+    ++s->used;
+    if (is_full(s, block))
+        unlink(partial[c], s);
+    stats.live += block;
+    return p;
+}
+
+void small_free(Span *s, void *p) noexcept {
+    size_t c     = s->kind;
+    size_t block = class_sizes[c];
+    if (is_full(s, block))
+        push_front(partial[c], s);
+    auto b  = static_cast<FreeBlock *>(p);
+    b->next = s->free;
+    s->free = b;
+    --s->used;
+    stats.live -= block;
+#ifdef EMLITE_SLAB_RECYCLE
+    // Keep one slab per class, so that a block allocated and freed in a loop
+    // doesn't take and return a slab every time
+    if (s->used == 0 && (s->prev || s->next)) {
+        unlink(partial[c], s);
+        release(s, 1);
+    }
+#endif
+}
+
+void *large_malloc(size_t size) noexcept {
+    size_t slabs = (header_size + size + slab_size - 1) / slab_size;
+    Span *s;
+    if (slabs > max_large_slabs) {
+        size_t bytes = header_size + size + slab_size - 1;
+        auto p       = static_cast<char *>(emlite_malloc(bytes));
+        if (!p)
+            return nullptr;
+        stats.footprint += bytes;
+        s       = reinterpret_cast<Span *>(align_up(p, slab_size));
+        s->kind = span_huge;
+        s->bump = p;
+    } else {
+        s = acquire(slabs);
+        if (!s)
+            return nullptr;
+        s->kind  = span_large;
+        s->slabs = static_cast<uint32_t>(slabs);
+    }
+    s->cookie = cookie_of(s);
+    s->size   = size;
+    stats.live += size;
+    return reinterpret_cast<char *>(s) + header_size;
+}
+} // namespace
+
+void *slab_malloc(size_t size) noexcept {
+    if (size <= max_small)
+        return small_malloc(class_table.idx[(size + 15) / 16]);
+    return large_malloc(size);
+}
+
+void slab_free(void *p) noexcept {
+    if (!p)
+        return;
+    auto s = reinterpret_cast<Span *>(
+        reinterpret_cast<uintptr_t>(p) & ~static_cast<uintptr_t>(slab_size - 1)
+    );
+    if (s->cookie != cookie_of(s)) {
+        emlite_free(p);
+        return;
+    }
+    if (s->kind < class_count) {
+        small_free(s, p);
+    } else if (s->kind == span_large) {
+        stats.live -= s->size;
+        release(s, s->slabs);
+    } else {
+        stats.live -= s->size;
+        stats.footprint -= header_size + s->size + slab_size - 1;
+        s->cookie = 0;
+        emlite_free(s->bump);
+    }
+}
+
+SlabStats slab_stats() noexcept { return stats; }
+} // namespace emlite
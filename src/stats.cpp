@@ -0,0 +1,24 @@
+#include <emlite/emlite.hpp>
+
+namespace emlite {
+namespace detail {
+Stats stats_data;
+} // namespace detail
+
+const Stats &stats() noexcept { return detail::stats_data; }
+
+void reset_stats() noexcept {
+    auto &s             = detail::stats_data;
+    auto live           = s.live_handles;
+    s                   = Stats{};
+    s.live_handles      = live;
+    s.peak_live_handles = live;
+}
+} // namespace emlite
+
+#ifdef EMLITE_STATS
+// Lets javascript read the statistics, see `Emlite.stats()` in scripts/index.js
+EMLITE_USED extern "C" const emlite::Stats *emlite_stats_data() { return &emlite::stats(); }
+
+EMLITE_USED extern "C" void emlite_stats_reset() { emlite::reset_stats(); }
+#endif
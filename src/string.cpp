@@ -0,0 +1,103 @@
+#include <emlite/emlite.hpp>
+
+namespace emlite {
+namespace {
+void copy_bytes(char *dst, const char *src, size_t len) noexcept {
+    for (size_t i = 0; i < len; ++i)
+        dst[i] = src[i];
+}
+
+int compare_bytes(const char *a, size_t alen, const char *b, size_t blen) noexcept {
+    size_t n = alen < blen ? alen : blen;
+    for (size_t i = 0; i < n; ++i) {
+        auto x = static_cast<unsigned char>(a[i]);
+        auto y = static_cast<unsigned char>(b[i]);
+        if (x != y)
+            return x < y ? -1 : 1;
+    }
+    return alen < blen ? -1 : alen > blen ? 1 : 0;
+}
+} // namespace
+
+String::String(const Val &v) noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    // Short strings are written inline by this first crossing, longer ones only
+    // report their length and keep the javascript string for later
+    len_ = detail::emlite_val_str_utf8_into(v.as_handle(), inline_, inline_size);
+    if (is_inline())
+        inline_[len_] = 0;
+    else
+        str_ = OwnedVal(v);
+#else
+    // Without emlite_val_str_utf8_into, the string is read whole at once
+    auto s    = detail::emlite_val_get_value_string(v.as_handle());
+    len_      = s ? strlen(s) : 0;
+    char *dst = is_inline() ? inline_ : (heap_ = new char[len_ + 1]);
+    copy_bytes(dst, s, len_);
+    dst[len_] = 0;
+    free(s);
+#endif
+}
+
+String::String(String &&other) noexcept
+    : str_(detail::move(other.str_)), len_(other.len_), heap_(other.heap_) {
+    copy_bytes(inline_, other.inline_, inline_size + 1);
+    other.len_  = 0;
+    other.heap_ = nullptr;
+}
+
+String &String::operator=(String &&other) noexcept {
+    if (this != &other) {
+        delete[] heap_;
+        str_  = detail::move(other.str_);
+        len_  = other.len_;
+        heap_ = other.heap_;
+        copy_bytes(inline_, other.inline_, inline_size + 1);
+        other.len_  = 0;
+        other.heap_ = nullptr;
+    }
+    return *this;
+}
+
+String::~String() { delete[] heap_; }
+
+const char *String::c_str() const noexcept {
+    if (is_inline())
+        return inline_;
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    if (!heap_) {
+        heap_ = new char[len_ + 1];
+        detail::emlite_val_str_utf8_into(str_.as_handle(), heap_, len_);
+        heap_[len_] = 0;
+    }
+#endif
+    return heap_;
+}
+
+int String::compare(StrView other) const noexcept {
+    if (is_inline() || heap_)
+        return compare_bytes(c_str(), len_, other.ptr, other.len);
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    return detail::emlite_val_str_compare(str_.as_handle(), other.ptr, other.len);
+#else
+    return 0; // the contents are always in linear memory
+#endif
+}
+
+bool String::starts_with(StrView prefix) const noexcept {
+    if (prefix.len > len_)
+        return false;
+    if (is_inline() || heap_)
+        return compare_bytes(c_str(), prefix.len, prefix.ptr, prefix.len) == 0;
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    return detail::emlite_val_str_starts_with(str_.as_handle(), prefix.ptr, prefix.len);
+#else
+    return false; // the contents are always in linear memory
+#endif
+}
+
+bool String::operator==(StrView other) const noexcept {
+    // The UTF-8 length is known up front, so most mismatches need no crossing
+    return other.len == len_ && compare(other) == 0;
+}
+} // namespace emlite
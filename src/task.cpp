@@ -0,0 +1,80 @@
+#include <emlite/emlite.hpp>
+
+// Runtime support for include/emlite/task.hpp. The library itself builds as
+// C++17, so these are defined here regardless of coroutine support.
+
+namespace emlite {
+namespace {
+/// Frames are rounded up to multiples of the granule, and freed frames of
+/// each size class are kept in a free list for reuse
+constexpr size_t frame_granule = 64;
+constexpr size_t frame_classes = 16;
+
+struct FreeFrame {
+    FreeFrame *next;
+};
+
+FreeFrame *free_frames[frame_classes];
+
+size_t frame_class(size_t size) noexcept { return (size + frame_granule - 1) / frame_granule; }
+
+#if !EMLITE_HAVE_RUNTIME_IMPORTS
+struct Settle {
+    void (*cb)(void *, Handle, bool);
+    void *data;
+};
+
+template <bool Fulfilled>
+Handle settle_callback(Handle args, Handle data) {
+    Val packed = Val::take_ownership(data);
+    auto s     = (Settle *)packed.as<uintptr_t>();
+    packed.release_handle();
+    auto value = Val::take_ownership(args)[0].release_handle();
+    auto cb    = s->cb;
+    auto d     = s->data;
+    delete s;
+    cb(d, value, Fulfilled);
+    return EMLITE_UNDEFINED;
+}
+#endif
+} // namespace
+
+namespace detail {
+void *frame_allocate(size_t size) {
+    size_t c = frame_class(size);
+    if (c > frame_classes)
+        return new char[size];
+    if (auto f = free_frames[c - 1]) {
+        free_frames[c - 1] = f->next;
+        return f;
+    }
+    return new char[c * frame_granule];
+}
+
+void frame_deallocate(void *p, size_t size) noexcept {
+    size_t c = frame_class(size);
+    if (c > frame_classes) {
+        delete[] static_cast<char *>(p);
+        return;
+    }
+    auto f             = static_cast<FreeFrame *>(p);
+    f->next            = free_frames[c - 1];
+    free_frames[c - 1] = f;
+}
+
+void promise_then(Handle promise, void (*cb)(void *, Handle, bool), void *data) noexcept {
+#if EMLITE_HAVE_RUNTIME_IMPORTS
+    Handle fidx = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(cb));
+    emlite_val_promise_then(promise, fidx, data);
+#else
+    // Without emlite_val_promise_then, go through a pair of callbacks.
+    // Only one of them ever runs, and it frees the shared state.
+    auto s       = new Settle{cb, data};
+    auto on_ok   = Val::make_fn(&settle_callback<true>, Val((uintptr_t)s));
+    auto on_err  = Val::make_fn(&settle_callback<false>, Val((uintptr_t)s));
+    auto resolve = Val::intrinsic(Intrinsic::Promise).call("resolve", ValRef(promise));
+    resolve.call("then", on_ok, on_err);
+#endif
+}
+} // namespace detail
+} // namespace emlite
@@ -0,0 +1,66 @@
+// Creates and drops 1M callbacks, checking that the wasm memory stays bounded,
+// then leaves callbacks to the garbage collector, checking that the
+// FinalizationRegistry hands their closures back to the pool.
+// Requires the freestanding build: npm run build:tests
+// and node --expose-gc
+
+import { Emlite } from "../scripts/index.js";
+
+const COUNT = 1_000_000;
+const DROPPED = 10_000;
+// The collector may still hold on to a few functions, so most slots coming back is enough
+const MIN_REUSED = DROPPED * 0.9;
+
+// Gives the collector a few chances to run the finalization callbacks
+async function collect() {
+    for (let i = 0; i < 20; i++) {
+        global.gc();
+        await new Promise((resolve) => setTimeout(resolve, 0));
+    }
+}
+
+async function main() {
+    if (typeof global.gc !== "function") {
+        console.error("Run with node --expose-gc");
+        process.exit(1);
+    }
+    const emlite = new Emlite();
+    // Records the pool slot of every closure created
+    const slots = [];
+    const makeClosure = emlite.env.emlite_val_make_closure;
+    emlite.env.emlite_val_make_closure = (fidx, dropidx, data, slot, cap) => {
+        slots.push(data >>> 0);
+        return makeClosure(fidx, dropidx, data, slot, cap);
+    };
+    const bytes = await emlite.readFile(new URL("../bin/freestanding/examples/closures.wasm", import.meta.url));
+    let wasm = await WebAssembly.compile(bytes);
+    let instance = await WebAssembly.instantiate(wasm, {
+        env: emlite.env,
+    });
+    emlite.setExports(instance.exports);
+    instance.exports.main();
+    // warm up so that the first pool chunk is already allocated
+    instance.exports.churn_closures(1000);
+    const before = instance.exports.memory.buffer.byteLength;
+    const ok = instance.exports.churn_closures(COUNT);
+    const after = instance.exports.memory.buffer.byteLength;
+    console.log(`${ok}/${COUNT} callbacks returned their value, memory ${before} -> ${after} bytes`);
+    if (ok !== COUNT || after !== before) {
+        process.exit(1);
+    }
+
+    // Closures which are never disposed: once collected, the next ones reuse their slots
+    slots.length = 0;
+    const dropped = instance.exports.drop_closures(DROPPED);
+    const first = new Set(slots);
+    await collect();
+    slots.length = 0;
+    instance.exports.drop_closures(DROPPED);
+    const reused = slots.filter((s) => first.has(s)).length;
+    console.log(`${dropped}/${DROPPED} dropped callbacks returned their value, ${reused}/${DROPPED} slots reused after gc`);
+    if (dropped !== DROPPED || reused < MIN_REUSED) {
+        process.exit(1);
+    }
+}
+
+await main();
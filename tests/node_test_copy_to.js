@@ -0,0 +1,48 @@
+// Copies javascript arrays into linear memory like Val::copy_to does, without a
+// wasm module, checking the conversions between numbers and BigInts.
+
+/* global EMLITE_VALMAP */
+import { Emlite } from "../scripts/index.js";
+
+const memory = new WebAssembly.Memory({ initial: 1 });
+const emlite = new Emlite();
+emlite.setExports({ memory });
+
+const DST = 64;
+
+// Copies src into a TypedArray of type ctor at DST, like Val::copy_to<T>
+function copyTo(src, ctor, cap) {
+    const n = emlite.env.emlite_val_copy_to(EMLITE_VALMAP.toHandle(src), EMLITE_VALMAP.toHandle(ctor), DST, cap);
+    return Array.from(new ctor(memory.buffer, DST, n));
+}
+
+const cases = [
+    // int64_t and uint64_t destinations from numbers
+    ["numbers into int64", [1, -2, 3.7], BigInt64Array, [1n, -2n, 3n]],
+    ["numbers into uint64", [1, 2 ** 40], BigUint64Array, [1n, 2n ** 40n]],
+    ["Float64Array into int64", new Float64Array([5, -6]), BigInt64Array, [5n, -6n]],
+    ["BigInts into int64", [7n, -8n], BigInt64Array, [7n, -8n]],
+    // and the reverse direction
+    ["BigInt64Array into double", new BigInt64Array([9n, -10n]), Float64Array, [9, -10]],
+    ["BigInts into int32", [11n], Int32Array, [11]],
+    // same element kinds, and the cap
+    ["Int32Array into double", new Int32Array([1, 2, 3]), Float64Array, [1, 2]],
+    ["BigUint64Array into int64", new BigUint64Array([12n]), BigInt64Array, [12n]],
+];
+
+let failed = 0;
+for (const [name, src, ctor, expected] of cases) {
+    let got;
+    try {
+        got = copyTo(src, ctor, name.startsWith("Int32Array") ? 2 : 16);
+    } catch (e) {
+        got = e;
+    }
+    const ok = Array.isArray(got) && got.length === expected.length && got.every((v, i) => v === expected[i]);
+    if (!ok) failed++;
+    console.log(`${ok ? "ok  " : "FAIL"} ${name} -> ${Array.isArray(got) ? got.join(", ") : String(got)}`);
+}
+console.log(`${cases.length - failed}/${cases.length} copies passed`);
+if (failed) {
+    process.exit(1);
+}
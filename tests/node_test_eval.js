@@ -0,0 +1,65 @@
+// Compiles EMLITE_EVAL snippets without a wasm module, checking how their
+// placeholders are substituted in code and inside string, template and regex literals.
+
+/* global EMLITE_VALMAP */
+import { Emlite } from "../scripts/index.js";
+
+const memory = new WebAssembly.Memory({ initial: 1 });
+const emlite = new Emlite();
+emlite.setExports({ memory });
+
+// Compiles a snippet like the EMLITE_EVAL macro does, from its stringized source
+function compile(src) {
+    const bytes = new TextEncoder().encode(src);
+    new Uint8Array(memory.buffer).set(bytes, 16);
+    return EMLITE_VALMAP.toValue(emlite.env.emlite_val_compile_eval(16, bytes.length));
+}
+
+const cases = [
+    // placeholders in code are the values themselves
+    ["%d + %d", [1, 2], 3],
+    ["{ let x = %d; x * 2 }", [21], 42],
+    ["%s.length", ["abc"], 3],
+    // inside literals they are formatted like snprintf would
+    ['"id-%d"', [7], "id-7"],
+    ["'%x'", [255], "ff"],
+    ['"%05.1f|%-4s|%+d"', [3.14159, "ab", 5], "003.1|ab  |+5"],
+    ["`%s and ${%d + 1}`", ["a", 1], "a and 2"],
+    ['"100%%"', [], "100%"],
+    // quotes and placeholders inside regex literals
+    ['"a\\"b".replace(/"/g, "")', [], "ab"],
+    ["\"it's\".replace(/'/, %d)", [1], "it1s"],
+    ["/%d+/.test(\"x%d\")", [4, 44], true],
+    ["/^[%s]$/i.source", ["ab"], "^[ab]$"],
+    ["\"a/b/c\".split(/[/]/).length", [], 3],
+    // division is not a regex
+    ["(%d) / 2 / 1", [8], 4],
+    ["let a = %d; a / 2 / 1", [8], 4],
+    ["let a = %d; a++ / 2", [8], 4],
+    ["let a = %d; a-- / 2 / 1", [8], 4],
+    // trailing statements keep the completion value eval gives them
+    ["if (%d > 1) { \"big\" } else { \"small\" }", [2], "big"],
+    ["let s = 0; for (let i = 0; i < %d; i++) { s += i }", [4], 6],
+    ["let a = %d; { a * 3 }", [2], 6],
+    ["let a = %d; a * 3;", [2], 6],
+    // the placeholder of a comment still takes its argument
+    ["// skips %d\n%d", [1, 2], 2],
+    ["return typeof /%s/", ["x"], "object"],
+];
+
+let failed = 0;
+for (const [src, args, expected] of cases) {
+    let got;
+    try {
+        got = compile(src)(...args);
+    } catch (e) {
+        got = e;
+    }
+    const ok = got === expected;
+    if (!ok) failed++;
+    console.log(`${ok ? "ok  " : "FAIL"} ${JSON.stringify(src)} -> ${String(got)}`);
+}
+console.log(`${cases.length - failed}/${cases.length} snippets passed`);
+if (failed) {
+    process.exit(1);
+}
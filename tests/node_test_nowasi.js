@@ -1,4 +1,4 @@
-import { Emlite } from "emlite";
+import { Emlite } from "../scripts/index.js";
 
 async function main() {
     const emlite = new Emlite();